@@ -175,3 +175,297 @@ do
 
     filter {}
 end
+
+project "lite_replay"
+do
+    kind "ConsoleApp"
+
+    -- @note(maihd): headless, replays render traces without a window or Lua
+    files {
+        path.join(ROOT_DIR, "src/tools/lite_replay.c"),
+        path.join(ROOT_DIR, "src/tools/lite_offscreen.c"),
+        path.join(ROOT_DIR, "src/lite_rencache.c"),
+        path.join(ROOT_DIR, "src/lite_renderer.c"),
+        path.join(ROOT_DIR, "src/lite_memory.c"),
+        path.join(ROOT_DIR, "src/lite_string.c"),
+        path.join(ROOT_DIR, "src/lite_thread.c"),
+        path.join(ROOT_DIR, "src/lib/stb/*.c"),
+    }
+
+    includedirs {
+        path.join(ROOT_DIR, "src/"),
+    }
+
+    targetdir (BUILD_DIR)
+
+    filter { "configurations:Release*" }
+    do
+        defines {
+            "NDEBUG"
+        }
+
+        filter {}
+    end
+
+    filter { "system:not windows" }
+    do
+        links {
+            "m",
+            "pthread",
+        }
+
+        filter {}
+    end
+
+    filter {}
+end
+
+project "lite_bench_pixels"
+do
+    kind "ConsoleApp"
+
+    -- @note(maihd): headless, compares the pixel kernels of the soft renderer
+    files {
+        path.join(ROOT_DIR, "src/tools/lite_bench_pixels.c"),
+        path.join(ROOT_DIR, "src/tools/lite_offscreen.c"),
+        path.join(ROOT_DIR, "src/lite_renderer.c"),
+        path.join(ROOT_DIR, "src/lite_memory.c"),
+        path.join(ROOT_DIR, "src/lite_string.c"),
+        path.join(ROOT_DIR, "src/lite_thread.c"),
+        path.join(ROOT_DIR, "src/lib/stb/*.c"),
+    }
+
+    includedirs {
+        path.join(ROOT_DIR, "src/"),
+    }
+
+    targetdir (BUILD_DIR)
+
+    filter { "configurations:Release*" }
+    do
+        defines {
+            "NDEBUG"
+        }
+
+        filter {}
+    end
+
+    filter { "system:not windows" }
+    do
+        links {
+            "m",
+            "pthread",
+        }
+
+        filter {}
+    end
+
+    filter {}
+end
+
+project "lite_bench_text"
+do
+    kind "ConsoleApp"
+
+    -- @note(maihd): headless, times text measuring over the tokens of a file
+    files {
+        path.join(ROOT_DIR, "src/tools/lite_bench_text.c"),
+        path.join(ROOT_DIR, "src/tools/lite_offscreen.c"),
+        path.join(ROOT_DIR, "src/lite_renderer.c"),
+        path.join(ROOT_DIR, "src/lite_memory.c"),
+        path.join(ROOT_DIR, "src/lite_string.c"),
+        path.join(ROOT_DIR, "src/lite_thread.c"),
+        path.join(ROOT_DIR, "src/lib/stb/*.c"),
+    }
+
+    includedirs {
+        path.join(ROOT_DIR, "src/"),
+    }
+
+    targetdir (BUILD_DIR)
+
+    filter { "configurations:Release*" }
+    do
+        defines {
+            "NDEBUG"
+        }
+
+        filter {}
+    end
+
+    filter { "system:not windows" }
+    do
+        links {
+            "m",
+            "pthread",
+        }
+
+        filter {}
+    end
+
+    filter {}
+end
+
+project "lite_bench_submit"
+do
+    kind "ConsoleApp"
+
+    -- @note(maihd): headless, times draw submission through the renderer module and the ffi batch
+    files {
+        path.join(ROOT_DIR, "src/tools/lite_bench_submit.c"),
+        path.join(ROOT_DIR, "src/tools/lite_offscreen.c"),
+        path.join(ROOT_DIR, "src/api/lite_renderer.c"),
+        path.join(ROOT_DIR, "src/api/lite_renderer_font.c"),
+        path.join(ROOT_DIR, "src/lite_rencache.c"),
+        path.join(ROOT_DIR, "src/lite_renderer.c"),
+        path.join(ROOT_DIR, "src/lite_memory.c"),
+        path.join(ROOT_DIR, "src/lite_string.c"),
+        path.join(ROOT_DIR, "src/lite_thread.c"),
+        path.join(ROOT_DIR, "src/lib/stb/*.c"),
+    }
+
+    includedirs {
+        path.join(ROOT_DIR, "src/"),
+        path.join(ROOT_DIR, "src/api"),
+        path.join(LIBS_DIR, "luajit_2.1.0-beta3/include"),
+    }
+
+    targetdir (BUILD_DIR)
+
+    filter { "configurations:Release*" }
+    do
+        defines {
+            "NDEBUG"
+        }
+
+        filter {}
+    end
+
+    filter { "system:windows" }
+    do
+        links {
+            "lua51_static",
+        }
+
+        filter {}
+    end
+
+    filter { "system:windows", "platforms:x86" }
+    do
+        libdirs {
+            path.join(LIBS_DIR, "luajit_2.1.0-beta3/prebuilt/x86"),
+        }
+
+        filter {}
+    end
+
+    filter { "system:windows", "platforms:x64" }
+    do
+        libdirs {
+            path.join(LIBS_DIR, "luajit_2.1.0-beta3/prebuilt/x64"),
+        }
+
+        filter {}
+    end
+
+    filter { "system:not windows" }
+    do
+        links {
+            "luajit-5.1",
+            "m",
+            "pthread",
+            "dl",
+        }
+
+        filter {}
+    end
+
+    filter {}
+end
+
+project "lite_bench_cells"
+do
+    kind "ConsoleApp"
+
+    -- @note(maihd): headless, compares render cache cell sizes on editor-like frames
+    files {
+        path.join(ROOT_DIR, "src/tools/lite_bench_cells.c"),
+        path.join(ROOT_DIR, "src/tools/lite_offscreen.c"),
+        path.join(ROOT_DIR, "src/lite_rencache.c"),
+        path.join(ROOT_DIR, "src/lite_renderer.c"),
+        path.join(ROOT_DIR, "src/lite_memory.c"),
+        path.join(ROOT_DIR, "src/lite_string.c"),
+        path.join(ROOT_DIR, "src/lite_thread.c"),
+        path.join(ROOT_DIR, "src/lib/stb/*.c"),
+    }
+
+    includedirs {
+        path.join(ROOT_DIR, "src/"),
+    }
+
+    targetdir (BUILD_DIR)
+
+    filter { "configurations:Release*" }
+    do
+        defines {
+            "NDEBUG"
+        }
+
+        filter {}
+    end
+
+    filter { "system:not windows" }
+    do
+        links {
+            "m",
+            "pthread",
+        }
+
+        filter {}
+    end
+
+    filter {}
+end
+
+project "lite_bench_hash"
+do
+    kind "ConsoleApp"
+
+    -- @note(maihd): headless, times hashing of each render cache command type
+    files {
+        path.join(ROOT_DIR, "src/tools/lite_bench_hash.c"),
+        path.join(ROOT_DIR, "src/tools/lite_offscreen.c"),
+        path.join(ROOT_DIR, "src/lite_renderer.c"),
+        path.join(ROOT_DIR, "src/lite_memory.c"),
+        path.join(ROOT_DIR, "src/lite_string.c"),
+        path.join(ROOT_DIR, "src/lite_thread.c"),
+        path.join(ROOT_DIR, "src/lib/stb/*.c"),
+    }
+
+    includedirs {
+        path.join(ROOT_DIR, "src/"),
+    }
+
+    targetdir (BUILD_DIR)
+
+    filter { "configurations:Release*" }
+    do
+        defines {
+            "NDEBUG"
+        }
+
+        filter {}
+    end
+
+    filter { "system:not windows" }
+    do
+        links {
+            "m",
+            "pthread",
+        }
+
+        filter {}
+    end
+
+    filter {}
+end
@@ -1,6 +1,7 @@
 #include "lite_renderer.h"
 #include "lite_api.h"
 #include "lite_rencache.h"
+#include "lite_rencache_ffi.h"
 
 static LiteColor checkcolor(lua_State* L, int idx, int def)
 {
@@ -29,6 +30,137 @@ static int f_show_debug(lua_State* L)
     return 0;
 }
 
+static int f_show_hud(lua_State* L)
+{
+    luaL_checkany(L, 1);
+    lite_rencache_show_hud(lua_toboolean(L, 1));
+    return 0;
+}
+
+static int f_get_stats(lua_State* L)
+{
+    LiteRencacheStats stats;
+    lite_rencache_get_stats(&stats);
+
+    lua_createtable(L, 0, 10);
+    lua_pushnumber(L, stats.command_count);
+    lua_setfield(L, -2, "command_count");
+    lua_pushnumber(L, stats.command_bytes);
+    lua_setfield(L, -2, "command_bytes");
+    lua_pushnumber(L, stats.dirty_cells);
+    lua_setfield(L, -2, "dirty_cells");
+    lua_pushnumber(L, stats.dirty_rects);
+    lua_setfield(L, -2, "dirty_rects");
+    lua_pushnumber(L, (lua_Number)stats.pixels);
+    lua_setfield(L, -2, "pixels");
+    lua_pushnumber(L, (lua_Number)stats.glyphs);
+    lua_setfield(L, -2, "glyphs");
+    lua_pushnumber(L, stats.hash_time);
+    lua_setfield(L, -2, "hash_time");
+    lua_pushnumber(L, stats.raster_time);
+    lua_setfield(L, -2, "raster_time");
+    lua_pushnumber(L, stats.present_time);
+    lua_setfield(L, -2, "present_time");
+    lua_pushnumber(L, stats.frame_time);
+    lua_setfield(L, -2, "frame_time");
+    return 1;
+}
+
+static int f_get_memory(lua_State* L)
+{
+    LiteRendererMemory memory = lite_renderer_get_memory();
+
+    lua_createtable(L, 0, 6);
+    lua_pushnumber(L, memory.fonts);
+    lua_setfield(L, -2, "fonts");
+    lua_pushnumber(L, memory.faces);
+    lua_setfield(L, -2, "faces");
+    lua_pushnumber(L, memory.images);
+    lua_setfield(L, -2, "images");
+    lua_pushnumber(L, (lua_Number)memory.face_bytes);
+    lua_setfield(L, -2, "face_bytes");
+    lua_pushnumber(L, (lua_Number)memory.atlas_bytes);
+    lua_setfield(L, -2, "atlas_bytes");
+    lua_pushnumber(L, (lua_Number)memory.image_bytes);
+    lua_setfield(L, -2, "image_bytes");
+    return 1;
+}
+
+static int f_start_trace(lua_State* L)
+{
+    LiteStringView filename = lua_checkstringview(L, 1);
+    lua_pushboolean(L, lite_rencache_start_trace(filename));
+    return 1;
+}
+
+static int f_stop_trace(lua_State* L)
+{
+    lite_rencache_stop_trace();
+    return 0;
+}
+
+static int f_set_cell_size(lua_State* L)
+{
+    lite_rencache_set_cell_size((int32_t)luaL_checknumber(L, 1));
+    return 0;
+}
+
+static int f_get_cell_size(lua_State* L)
+{
+    lua_pushnumber(L, lite_rencache_get_cell_size());
+    return 1;
+}
+
+static int f_set_merge_threshold(lua_State* L)
+{
+    lite_rencache_set_merge_threshold((int32_t)luaL_checknumber(L, 1));
+    return 0;
+}
+
+static int f_get_merge_threshold(lua_State* L)
+{
+    lua_pushnumber(L, lite_rencache_get_merge_threshold());
+    return 1;
+}
+
+static int f_has_pending_glyphs(lua_State* L)
+{
+    lua_pushboolean(L, lite_rencache_has_pending_glyphs());
+    return 1;
+}
+
+static int f_set_glyph_budget(lua_State* L)
+{
+    lite_set_glyph_budget((size_t)luaL_checknumber(L, 1));
+    return 0;
+}
+
+static int f_get_glyph_budget(lua_State* L)
+{
+    lua_pushnumber(L, (lua_Number)lite_get_glyph_budget());
+    return 1;
+}
+
+static int f_set_glyph_sdf(lua_State* L)
+{
+    luaL_checkany(L, 1);
+    lite_set_glyph_sdf(lua_toboolean(L, 1));
+    return 0;
+}
+
+static int f_get_glyph_sdf(lua_State* L)
+{
+    lua_pushboolean(L, lite_get_glyph_sdf());
+    return 1;
+}
+
+static int f_set_glyph_cache_dir(lua_State* L)
+{
+    LiteStringView path = lua_isnoneornil(L, 1) ? lite_string_view("", 0) : lua_checkstringview(L, 1);
+    lite_set_glyph_cache_dir(path);
+    return 0;
+}
+
 static int f_get_size(lua_State* L)
 {
     int w, h;
@@ -85,15 +217,83 @@ static int f_draw_text(lua_State* L)
     return 1;
 }
 
+/* tokens is { text, color, text, color, ... }, colors are tables like for
+** draw_text or numbers packed as 0xrrggbbaa */
+static int f_draw_tokens(lua_State* L)
+{
+    LiteFont**		font   = luaL_checkudata(L, 1, API_TYPE_FONT);
+    int				x      = (int)luaL_checknumber(L, 2);
+    int				y      = (int)luaL_checknumber(L, 3);
+    luaL_checktype(L, 4, LUA_TTABLE);
+
+    int32_t			count  = (int32_t)lua_objlen(L, 4) / 2;
+    LiteTextToken*	tokens = lua_newuserdata(L, count * sizeof(LiteTextToken));
+    for (int32_t i = 0; i < count; i++)
+    {
+        /* the table keeps the strings alive once they are popped */
+        lua_rawgeti(L, 4, 2 * i + 1);
+        lua_rawgeti(L, 4, 2 * i + 2);
+
+        size_t length;
+        const char* text = lua_tolstring(L, -2, &length);
+        if (text == nullptr)
+        {
+            return luaL_error(L, "token %d is not a string", i + 1);
+        }
+        tokens[i].text = lite_string_view(text, length);
+
+        if (lua_type(L, -1) == LUA_TNUMBER)
+        {
+            uint32_t packed = (uint32_t)lua_tonumber(L, -1);
+            tokens[i].color = (LiteColor){
+                .r = (uint8_t)(packed >> 24), .g = (uint8_t)(packed >> 16), .b = (uint8_t)(packed >> 8), .a = (uint8_t)packed,
+            };
+        }
+        else
+        {
+            tokens[i].color = checkcolor(L, lua_gettop(L), 255);
+        }
+        lua_pop(L, 2);
+    }
+
+    int				next_x = lite_rencache_draw_tokens(*font, tokens, count, x, y);
+    lua_pushnumber(L, next_x);
+    return 1;
+}
+
+/* the batch LuaJIT writes into through the ffi, see lite_rencache_ffi.h */
+static int f_get_ffi(lua_State* L)
+{
+    lua_pushlightuserdata(L, lite_rencache_get_ffi());
+    return 1;
+}
+
 static const luaL_Reg lib[] = {
-    {"show_debug",    f_show_debug   },
-    {"get_size",      f_get_size     },
-    {"begin_frame",   f_begin_frame  },
-    {"end_frame",     f_end_frame    },
-    {"set_clip_rect", f_set_clip_rect},
-    {"draw_rect",     f_draw_rect    },
-    {"draw_text",     f_draw_text    },
-    {NULL,            NULL           }
+    {"show_debug",          f_show_debug         },
+    {"show_hud",            f_show_hud           },
+    {"get_stats",           f_get_stats          },
+    {"get_memory",          f_get_memory         },
+    {"start_trace",         f_start_trace        },
+    {"stop_trace",          f_stop_trace         },
+    {"set_cell_size",       f_set_cell_size      },
+    {"get_cell_size",       f_get_cell_size      },
+    {"set_merge_threshold", f_set_merge_threshold},
+    {"get_merge_threshold", f_get_merge_threshold},
+    {"has_pending_glyphs",  f_has_pending_glyphs },
+    {"set_glyph_budget",    f_set_glyph_budget   },
+    {"get_glyph_budget",    f_get_glyph_budget   },
+    {"set_glyph_sdf",       f_set_glyph_sdf      },
+    {"get_glyph_sdf",       f_get_glyph_sdf      },
+    {"set_glyph_cache_dir", f_set_glyph_cache_dir},
+    {"get_size",            f_get_size           },
+    {"begin_frame",         f_begin_frame        },
+    {"end_frame",           f_end_frame          },
+    {"set_clip_rect",       f_set_clip_rect      },
+    {"draw_rect",           f_draw_rect          },
+    {"draw_text",           f_draw_text          },
+    {"draw_tokens",         f_draw_tokens        },
+    {"get_ffi",             f_get_ffi            },
+    {NULL,                  NULL                 }
 };
 
 int luaopen_renderer_font(lua_State* L);
@@ -103,5 +303,7 @@ int luaopen_renderer(lua_State* L)
     luaL_newlib(L, lib);
     luaopen_renderer_font(L);
     lua_setfield(L, -2, "font");
+    lua_pushstring(L, LITE_RENCACHE_FFI_CDEF);
+    lua_setfield(L, -2, "ffi_cdef");
     return 1;
 }
@@ -47,6 +47,46 @@ static int f_get_width(lua_State* L)
 }
 
 
+/* x of every byte index of text, and of #text + 1 last */
+static int f_get_advances(lua_State* L)
+{
+    LiteFont**		self = luaL_checkudata(L, 1, API_TYPE_FONT);
+    LiteStringView	text = lua_checkstringview(L, 2);
+    int32_t*		xs   = lua_newuserdata(L, (text.length + 1) * sizeof(int32_t));
+    lite_get_font_advances(*self, text, xs);
+
+    lua_createtable(L, (int)text.length + 1, 0);
+    for (size_t i = 0; i <= text.length; i++)
+    {
+        lua_pushinteger(L, xs[i]);
+        lua_rawseti(L, -2, (int)i + 1);
+    }
+    return 1;
+}
+
+
+/* byte index of the character edge closest to x, 1 to #text + 1 */
+static int f_get_offset_at(lua_State* L)
+{
+    LiteFont**		self = luaL_checkudata(L, 1, API_TYPE_FONT);
+    LiteStringView	text = lua_checkstringview(L, 2);
+    int32_t			x    = (int32_t)luaL_checknumber(L, 3);
+    lua_pushinteger(L, (lua_Integer)lite_get_font_offset_at(*self, text, x) + 1);
+    return 1;
+}
+
+
+/* x of a byte index, an index inside a character gives the x of its start */
+static int f_get_x_at(lua_State* L)
+{
+    LiteFont**		self  = luaL_checkudata(L, 1, API_TYPE_FONT);
+    LiteStringView	text  = lua_checkstringview(L, 2);
+    lua_Integer		index = luaL_checkinteger(L, 3);
+    lua_pushinteger(L, lite_get_font_x_at(*self, text, index > 1 ? (size_t)(index - 1) : 0));
+    return 1;
+}
+
+
 static int f_get_height(lua_State* L)
 {
     LiteFont** self = luaL_checkudata(L, 1, API_TYPE_FONT);
@@ -60,6 +100,9 @@ static const luaL_Reg lib[] = {
     { "load",          f_load          },
     { "set_tab_width", f_set_tab_width },
     { "get_width",     f_get_width     },
+    { "get_advances",  f_get_advances  },
+    { "get_offset_at", f_get_offset_at },
+    { "get_x_at",      f_get_x_at      },
     { "get_height",    f_get_height    },
     { nullptr,         nullptr         },
 };
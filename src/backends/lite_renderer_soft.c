@@ -7,13 +7,49 @@
 
 #include "lib/stb/stb_truetype.h"
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define LITE_PIXEL_X86 1
+#   include <immintrin.h>
+#   if defined(_MSC_VER) && !defined(__clang__)
+#       include <intrin.h>
+#   else
+#       include <cpuid.h>
+#   endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define LITE_PIXEL_NEON 1
+#   include <arm_neon.h>
+#endif
+
+/// kernels for instruction sets above the build's baseline are compiled per
+/// function, so one binary runs everywhere and picks them up at init
+#if defined(__GNUC__) || defined(__clang__)
+#   define LITE_TARGET(isa) __attribute__((target(isa)))
+#else
+#   define LITE_TARGET(isa)
+#endif
+
 #include "lite_meta.h"
 #include "lite_memory.h"
+#include "lite_thread.h"
 #include "lite_window.h"
 #include "lite_renderer.h"
 
 
-enum { MAX_GLYPHSET = 256, GLYPHSET_CHARS = 256 };
+/* glyph atlas pages are square, at least this many pixels wide and tall */
+enum { GLYPH_PAGE_MIN_SIZE = 256, GLYPH_PAGE_MAX_SIZE = 4096 };
+
+/* key the missing glyph is cached under, codepoints the font lacks share it */
+#define GLYPH_NOTDEF 0xffffffffu
+
+/* sdf fonts draw every size from distance fields rasterized once per font
+** file at the reference size, 128 is on the outline, values grow inside by
+** SDF_DISTANCE_SCALE per reference pixel and reach SDF_PADDING pixels out */
+enum { SDF_REFERENCE_SIZE = 48, SDF_PADDING = 6, SDF_ON_EDGE = 128, SDF_SPAN = 256 };
+#define SDF_DISTANCE_SCALE ((float)SDF_ON_EDGE / SDF_PADDING)
+
+/* regions are rasterized by a pool of workers plus the calling thread, small
+** batches are not worth waking the workers for */
+enum { MAX_RENDER_WORKERS = 16, PARALLEL_MIN_PIXELS = 256 * 256 };
 
 
 struct LiteImage
@@ -23,32 +59,214 @@ struct LiteImage
 };
 
 
-typedef struct LiteGlyphSet
+/* a glyph rasterized on demand into one of its font's atlas pages */
+typedef struct LiteGlyph
 {
-    LiteImage*          image;
-    stbtt_bakedchar     glyphs[GLYPHSET_CHARS];
-} LiteGlyphSet;
+    uint32_t            codepoint;
+    int32_t             index;      // stb glyph index, 0 for missing glyphs
+    int32_t             page;       // -1 while pending or when there is nothing to draw
+    int32_t             x, y, width, height;
+    int32_t             xoff, yoff;
+    int32_t             xadvance;
+    bool                pending;    // being rasterized in the background, drawn blank
+} LiteGlyph;
 
 
-struct LiteFont
+typedef struct LiteSkylineNode
+{
+    int32_t             x, y, width;
+} LiteSkylineNode;
+
+
+/* atlas pages keep 8-bit coverage, the text color is applied when glyphs
+** are blitted; glyphs are packed bottom-left along a skyline, a page is
+** only emptied as a whole when it is evicted */
+typedef struct LiteGlyphPage
 {
-    void*               data;
+    uint8_t*            coverage;
+    LiteSkylineNode*    nodes;
+    int32_t             node_count;
+    uint32_t            last_used;
+} LiteGlyphPage;
+
+
+/* a font file, mapped once and shared by every size loaded from it */
+typedef struct LiteFontFace LiteFontFace;
+struct LiteFontFace
+{
+    LiteFontFace*       next;
+    LiteStringView      filename;
+    const uint8_t*      data;
+    size_t              data_size;
     stbtt_fontinfo      stbfont;
+    int32_t             refs;
+    LiteFont*           sdf;    // reference size distance fields, made for the first sdf font
+    uint64_t            hash;   // of the file, keys glyph caches, 0 until one is used
+};
+
+
+/* a face at one size, with the glyphs rasterized for it */
+struct LiteFont
+{
+    LiteFontFace*       face;
     float               size;
+    float               scale;
+    int32_t             ascent;
     int32_t             height;
-    LiteGlyphSet*       sets[MAX_GLYPHSET];
+    int32_t             tab_width;
+
+    /* codepoint -> glyph index + 1, open addressing with linear probing,
+    ** ascii is indexed directly */
+    int32_t*            map;
+    uint32_t            map_mask;
+    int32_t             ascii[128];
+
+    /* advances never change once measured, so ascii text is measured from
+    ** this table; its glyphs are kept cached while the table is used */
+    int32_t             ascii_advance[128];
+    uint32_t            ascii_epoch;
+    int32_t             fixed_advance;  // of printable ascii in fixed-pitch fonts, else 0
+
+    /* how far any glyph reaches from the pen, from the face's bounding box,
+    ** so text outside the clip is passed over by advances alone */
+    int32_t             ink_left, ink_right, ink_top, ink_bottom;
+
+    /* sdf fonts keep metrics only and draw the glyphs of their face's
+    ** reference font, whose pages hold distances instead of coverage */
+    LiteFont*           sdf;
+    bool                distance_field;
+    uint8_t             sdf_ramp[256];  // sampled distance -> coverage at this size
+
+    bool                cache_miss;     // write the glyph cache once ascii is rasterized
+
+    LiteGlyph*          glyphs;
+    int32_t             glyph_count, glyph_capacity;
+
+    LiteGlyphPage*      pages;
+    int32_t             page_count;
+    int32_t             page_size;
+
+    int32_t             pending_count;
+
+    /* glyphs missed while a frame was being drawn, measured only and seen
+    ** by the recording thread alone until lite_poll_glyphs loads them */
+    LiteGlyph*          staged;
+    int32_t             staged_count, staged_capacity;
+    LiteFont*           next_staged;
 };
 
 
 static LiteImage        g_surface;
-static LiteArena*       g_img_arena;
-static LiteArena*       g_font_arena;
+static LiteFontFace*    g_faces;
+
+/* live fonts, faces and images, only touched on the main thread */
+static LiteRendererMemory g_memory;
+
+/* atlas memory each font may keep before evicting its least recently used
+** page, pages in use since the draw before last are never evicted so it is a
+** soft limit; the epoch moves on once per lite_renderer_draw_regions, which
+** may run on another thread while the main thread measures the next frame,
+** so it is only touched with lite_atomic_add and read with glyph_epoch */
+static size_t            g_glyph_budget = 4 * 1024 * 1024;
+static volatile int32_t  g_glyph_epoch  = 1;
+static bool             g_glyph_async  = true;
+static bool             g_glyph_sdf    = false;
+static char*            g_glyph_cache_dir;
+
+
+static inline uint32_t glyph_epoch(void)
+{
+    return (uint32_t)lite_atomic_load(&g_glyph_epoch);
+}
+
+
+/* held while lite_renderer_draw_regions reads the surface and the glyphs, so
+** a thread drawing frames leaves the main thread free to measure text; the
+** main thread takes it to change the glyph cache or to replace the surface */
+static LiteMutex*                   g_draw_lock;
+static thread_local int32_t         g_draw_lock_depth;
+
+/* set on the thread that called lite_renderer_init, the one recording frames
+** and the only one that loads glyphs */
+static thread_local bool            g_recording_thread;
+
+/* fonts with staged glyphs, only touched on the recording thread */
+static LiteFont*                    g_staged_fonts;
+
+
+/* every thread that draws owns its clip, target and counters, so workers can
+** rasterize disjoint regions of the surface at the same time */
+typedef struct LiteRenderContext
+{
+    LiteImage*          target;
+
+    struct
+    {
+        int32_t left, top, right, bottom;
+    } clip;
+
+    LiteRendererStats   stats;
+} LiteRenderContext;
+
+static thread_local LiteRenderContext g_context = { .target = &g_surface };
+
+/* counters folded in from the workers, guarded by g_workers.mutex */
+static LiteRendererStats g_stats;
+
+
+static struct
+{
+    LiteThread*             threads[MAX_RENDER_WORKERS];
+    int32_t                 thread_count;
+
+    LiteMutex*              mutex;
+    LiteCondition*          wake;
+    LiteCondition*          done;
+    uint32_t                generation;
+    int32_t                 running;
+    bool                    quit;
+
+    const LiteRect*         regions;
+    int32_t                 region_count;
+    volatile int32_t        next_region;
+    LiteRegionDrawFunc*     func;
+    void*                   userdata;
+} g_workers;
+
+
+/* glyphs are rasterized by a background thread, the main thread copies
+** finished ones into the atlas pages in lite_poll_glyphs */
+typedef struct LiteGlyphJob
+{
+    LiteFont*           font;
+    uint32_t            codepoint;
+    int32_t             index;
+    int32_t             width, height;
+    uint8_t*            coverage;
+} LiteGlyphJob;
 
 
 static struct
 {
-    int32_t left, top, right, bottom;
-} clip;
+    LiteThread*         thread;
+    LiteMutex*          mutex;
+    LiteCondition*      wake;
+    LiteCondition*      idle;
+    bool                quit;
+
+    LiteGlyphJob*       queue;
+    int32_t             queue_head, queue_count, queue_capacity;
+
+    LiteGlyphJob*       done;
+    int32_t             done_count, done_capacity;
+
+    LiteFont*           busy;   // font of the glyph being rasterized
+} g_rasterizer;
+
+
+static void init_pixel_kernels(void);
+static void init_rasterizer(void);
+static void deinit_rasterizer(void);
 
 
 // @todo: replace with assert
@@ -65,426 +283,2667 @@ static void* check_alloc(void* ptr)
 }
 
 
+/* decode one codepoint, malformed, overlong or truncated sequences decode
+** to U+FFFD and only skip their first byte */
 static LiteStringView utf8_to_codepoint(LiteStringView p, uint32_t* dst)
 {
-	assert(p.buffer != nullptr);
-	assert(p.length > 0);
+    assert(p.buffer != nullptr);
+    assert(p.length > 0);
 
-    uint32_t res, n;
-    switch (*p.buffer & 0xf0)
+    const uint8_t* s = (const uint8_t*)p.buffer;
+    uint32_t       res, min;
+    size_t         n;
+    if (s[0] < 0x80)
     {
-    case 0xf0:
-        res = *p.buffer & 0x07;
-        n   = 3;
-        break;
-
-    case 0xe0:
-        res = *p.buffer & 0x0f;
-        n   = 2;
-        break;
-
-    case 0xd0:
-    case 0xc0:
-        res = *p.buffer & 0x1f;
+        *dst      = s[0];
+        p.buffer += 1;
+        p.length -= 1;
+        return p;
+    }
+    else if ((s[0] & 0xe0) == 0xc0)
+    {
+        res = s[0] & 0x1f;
+        min = 0x80;
         n   = 1;
-        break;
-
-    default:
-        res = *p.buffer;
-        n   = 0;
-        break;
     }
-
-    while (n--)
+    else if ((s[0] & 0xf0) == 0xe0)
+    {
+        res = s[0] & 0x0f;
+        min = 0x800;
+        n   = 2;
+    }
+    else if ((s[0] & 0xf8) == 0xf0)
+    {
+        res = s[0] & 0x07;
+        min = 0x10000;
+        n   = 3;
+    }
+    else
     {
-		p.buffer += 1;
-		p.length -= 1;
+        n   = p.length;
+    }
 
-        res = (res << 6) | (*p.buffer & 0x3f);
+    bool valid = n < p.length;
+    for (size_t i = 1; valid && i <= n; i++)
+    {
+        valid = (s[i] & 0xc0) == 0x80;
+        res   = (res << 6) | (s[i] & 0x3f);
     }
 
-    *dst = res;
+    if (!valid || res < min || res > 0x10ffff || (res >= 0xd800 && res <= 0xdfff))
+    {
+        res = 0xfffd;
+        n   = 0;
+    }
 
-    p.buffer += 1;
-	p.length -= 1;
-	return p;
+    *dst      = res;
+    p.buffer += n + 1;
+    p.length -= n + 1;
+    return p;
 }
 
 
-void lite_renderer_init(void)
-{
-    g_surface.pixels  = (LiteColor*)lite_window_surface(
-        &g_surface.width, &g_surface.height
-    );
+/* length of the printable ascii run text starts with, so text can skip
+** decoding and index glyphs and advances directly, tabs and control
+** characters end runs since their advances differ; picked with the pixel
+** kernels */
+typedef size_t LiteTextRunFunc(const char* text, size_t length);
 
-    lite_renderer_set_clip_rect((LiteRect){
-                                    .x = 0,
-                                    .y = 0,
-                                    .width = g_surface.width,
-                                    .height = g_surface.height
-                                });
 
-    g_img_arena = lite_arena_create(1 * 1024 * 1024, 20 * 1024 * 1024, alignof(LiteColor));
-    g_font_arena = lite_arena_create(1 * 1024 * 1024, 20 * 1024 * 1024, alignof(LiteGlyphSet));
+static size_t text_run_scalar(const char* text, size_t length)
+{
+    size_t i = 0;
+    while (i < length && (uint8_t)(text[i] - 0x20) < 0x5f)
+    {
+        i++;
+    }
+    return i;
 }
 
 
-void lite_renderer_deinit(void)
+#if LITE_PIXEL_X86
+/* index of the lowest set bit, mask must not be 0 */
+static inline int32_t lowest_bit(uint32_t mask)
 {
-    lite_arena_destroy(g_font_arena);
-    lite_arena_destroy(g_img_arena);
-    g_font_arena = nullptr;
-    g_img_arena = nullptr;
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int32_t)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
 
-    assert(g_img_arena == nullptr && "Leak arena in renderer");
-    assert(g_font_arena == nullptr && "Leak arena in renderer");
+/* bits of the bytes ending a run, bytes above 0x7f are negative as signed
+** so one range check covers them */
+LITE_TARGET("sse2")
+static inline uint32_t run_stops_sse2(const char* text)
+{
+    __m128i bytes = _mm_loadu_si128((const __m128i*)text);
+    __m128i above = _mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1f));
+    __m128i below = _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x7f));
+    return ~(uint32_t)_mm_movemask_epi8(_mm_and_si128(above, below)) & 0xffff;
 }
 
 
-void lite_renderer_update_rects(LiteRect* rects, int32_t count)
+LITE_TARGET("sse2")
+static size_t text_run_sse2(const char* text, size_t length)
 {
-    lite_window_update_rects(rects, (uint32_t)count);
+    if (length < 16)
+    {
+        return text_run_scalar(text, length);
+    }
 
-    static bool initial_frame = true;
-    if (initial_frame)
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
     {
-        lite_window_show();
-        initial_frame = false;
+        uint32_t stops = run_stops_sse2(text + i);
+        if (stops)
+        {
+            return i + lowest_bit(stops);
+        }
     }
+
+    /* the tail is checked by a load overlapping bytes already known good */
+    uint32_t stops = i < length ? run_stops_sse2(text + length - 16) : 0;
+    return stops ? length - 16 + lowest_bit(stops) : length;
 }
 
 
-void lite_renderer_set_clip_rect(LiteRect rect)
+LITE_TARGET("avx2")
+static inline uint32_t run_stops_avx2(const char* text)
 {
-    clip.left   = rect.x;
-    clip.top    = rect.y;
-    clip.right  = rect.x + rect.width;
-    clip.bottom = rect.y + rect.height;
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)text);
+    __m256i above = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(0x1f));
+    __m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8(0x7f), bytes);
+    return ~(uint32_t)_mm256_movemask_epi8(_mm256_and_si256(above, below));
 }
 
 
-void lite_renderer_get_size(int32_t* x, int32_t* y)
+LITE_TARGET("avx2")
+static size_t text_run_avx2(const char* text, size_t length)
 {
-    assert(x);
-    assert(y);
+    if (length < 32)
+    {
+        return text_run_sse2(text, length);
+    }
 
-    lite_window_surface(x, y);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        uint32_t stops = run_stops_avx2(text + i);
+        if (stops)
+        {
+            return i + lowest_bit(stops);
+        }
+    }
+
+    uint32_t stops = i < length ? run_stops_avx2(text + length - 32) : 0;
+    return stops ? length - 32 + lowest_bit(stops) : length;
 }
+#endif
 
 
-LiteImage* lite_new_image(int32_t width, int32_t height)
+#if LITE_PIXEL_NEON
+static size_t text_run_neon(const char* text, size_t length)
 {
-    assert(width > 0 && height > 0);
-
-    // @todo(maihd): use Arena instead of malloc
-    LiteImage* image =
-        (LiteImage*)lite_arena_acquire(g_img_arena, sizeof(LiteImage) + width * height * sizeof(LiteColor));
-    check_alloc(image);
-    image->pixels = (LiteColor*)(image + 1);
-    image->width  = width;
-    image->height = height;
-    return image;
+    /* no movemask, chunks are only tested and the one ending the run is
+    ** scanned bytewise */
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        uint8x16_t bytes = vsubq_u8(vld1q_u8((const uint8_t*)text + i), vdupq_n_u8(0x20));
+        if (vmaxvq_u8(bytes) >= 0x5f)
+        {
+            break;
+        }
+    }
+    return i + text_run_scalar(text + i, length - i);
 }
+#endif
 
 
-void lite_free_image(LiteImage* image)
+static LiteTextRunFunc*  g_text_run = text_run_scalar;
+
+
+static void flush_context_stats(void)
 {
-//     free(image);
+    g_stats.pixels          += g_context.stats.pixels;
+    g_stats.glyphs          += g_context.stats.glyphs;
+    g_context.stats.pixels   = 0;
+    g_context.stats.glyphs   = 0;
 }
 
 
-static LiteGlyphSet* load_glyphset(LiteFont* font, int32_t idx)
+/* regions of a frame recorded before a resize may reach past the surface */
+static bool clamp_to_surface(LiteRect* r)
 {
-    LiteGlyphSet* set = check_alloc(calloc(1, sizeof(LiteGlyphSet)));
+    int32_t x1 = r->x < 0 ? 0 : r->x;
+    int32_t y1 = r->y < 0 ? 0 : r->y;
+    int32_t x2 = r->x + r->width;
+    int32_t y2 = r->y + r->height;
+    x2         = x2 > g_surface.width ? g_surface.width : x2;
+    y2         = y2 > g_surface.height ? g_surface.height : y2;
+    *r         = (LiteRect){ x1, y1, x2 - x1, y2 - y1 };
+    return x2 > x1 && y2 > y1;
+}
 
-    /* init image */
-    int32_t width  = 128;
-    int32_t height = 128;
 
+static void draw_worker_regions(int32_t worker)
+{
     for (;;)
     {
-        LiteArenaTemp temp = lite_arena_begin_temp(g_img_arena);
-        set->image = lite_new_image(width, height);
+        int32_t i = lite_atomic_add(&g_workers.next_region, 1);
+        if (i >= g_workers.region_count)
+        {
+            break;
+        }
+
+        LiteRect region = g_workers.regions[i];
+        if (clamp_to_surface(&region))
+        {
+            lite_renderer_set_clip_rect(region);
+            g_workers.func(g_workers.userdata, region, worker);
+        }
+    }
+}
 
-        /* load glyphs */
-        float s = stbtt_ScaleForMappingEmToPixels(&font->stbfont, 1) / stbtt_ScaleForPixelHeight(&font->stbfont, 1);
-        int32_t res = stbtt_BakeFontBitmap(font->data, 0, font->size * s,
-                                           (void*)set->image->pixels, width,
-                                           height, idx * 256, 256, set->glyphs);
 
-        /* retry with a larger image buffer if the buffer wasn't large enough */
-        if (res < 0)
+static int32_t render_worker_main(void* userdata)
+{
+    int32_t  worker     = (int32_t)(intptr_t)userdata;
+    uint32_t generation = 0;
+
+    lite_mutex_lock(g_workers.mutex);
+    for (;;)
+    {
+        while (!g_workers.quit && g_workers.generation == generation)
         {
-            width *= 2;
-            height *= 2;
+            lite_condition_wait(g_workers.wake, g_workers.mutex);
+        }
 
-            lite_arena_end_temp(temp);
-            continue;
+        if (g_workers.quit)
+        {
+            break;
         }
 
-        break;
-    }
+        generation = g_workers.generation;
+        lite_mutex_unlock(g_workers.mutex);
 
-    /* adjust glyph yoffsets and xadvance */
-    int32_t ascent, descent, linegap;
-    stbtt_GetFontVMetrics(&font->stbfont, &ascent, &descent, &linegap);
-    float   scale = stbtt_ScaleForMappingEmToPixels(&font->stbfont, font->size);
-    int32_t scaled_ascent = (int32_t)(ascent * scale + 0.5f);
-    for (int32_t i = 0; i < 256; i++)
-    {
-        set->glyphs[i].yoff += scaled_ascent;
-        set->glyphs[i].xadvance = floorf(set->glyphs[i].xadvance);
-    }
+        draw_worker_regions(worker);
 
-    // convert 8bit data to 32bit
-    // @todo(maihd): why must be pre-convert?
-    // @todo(maihd): why must be in reverted-order loop?
-    for (int32_t i = width * height - 1; i >= 0; i--)
-    {
-        uint8_t n = ((uint8_t*)set->image->pixels)[i];
-        set->image->pixels[i] =
-            (LiteColor){.r = 255, .g = 255, .b = 255, .a = n};
+        lite_mutex_lock(g_workers.mutex);
+        flush_context_stats();
+        if (--g_workers.running == 0)
+        {
+            lite_condition_signal(g_workers.done);
+        }
     }
+    lite_mutex_unlock(g_workers.mutex);
 
-    return set;
+    return 0;
 }
 
 
-static LiteGlyphSet* get_glyphset(LiteFont* font, int32_t codepoint)
+static void init_workers(void)
 {
-    int32_t idx = (codepoint >> 8) % MAX_GLYPHSET;
-    if (font->sets[idx] == NULL)
+    int32_t thread_count = lite_cpu_count() - 1;
+    if (thread_count > MAX_RENDER_WORKERS)
     {
-        font->sets[idx] = load_glyphset(font, idx);
+        thread_count = MAX_RENDER_WORKERS;
     }
 
-    return font->sets[idx];
-}
+    g_workers.thread_count = 0;
+    if (thread_count <= 0)
+    {
+        return;
+    }
 
+    g_workers.mutex = lite_mutex_create();
+    g_workers.wake  = lite_condition_create();
+    g_workers.done  = lite_condition_create();
+    g_workers.quit  = false;
 
-LiteFont* lite_load_font(LiteStringView filename, float size)
-{
-    LiteArenaTemp arena_temp = lite_arena_begin_temp(g_font_arena);
+    for (int32_t i = 0; i < thread_count; i++)
+    {
+        LiteThread* thread = lite_thread_create(render_worker_main, "lite-render", (void*)(intptr_t)(i + 1));
+        if (thread == nullptr)
+        {
+            break;
+        }
 
-    LiteFont* font = nullptr;
-    FILE*    fp   = nullptr;
+        g_workers.threads[g_workers.thread_count++] = thread;
+    }
+}
 
-    /* init font */
-    font       = check_alloc(lite_arena_acquire(g_font_arena, sizeof(LiteFont)));
-    memset(font, 0, sizeof(*font));
-    font->size = size;
 
-    /* load font into buffer */
-    fp = fopen(filename.buffer, "rb");
-    if (!fp)
+static void deinit_workers(void)
+{
+    if (g_workers.mutex == nullptr)
     {
-        return nullptr;
+        return;
     }
 
-    /* get size */
-    fseek(fp, 0, SEEK_END);
-    int32_t buf_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    lite_mutex_lock(g_workers.mutex);
+    g_workers.quit = true;
+    lite_condition_broadcast(g_workers.wake);
+    lite_mutex_unlock(g_workers.mutex);
 
-    /* load */
-    font->data = check_alloc(lite_arena_acquire(g_font_arena, buf_size));
-    size_t  _  = fread(font->data, 1, buf_size, fp);
-    (void)_;
-    fclose(fp);
-    fp = nullptr;
-
-    /* init stbfont */
-    int32_t ok = stbtt_InitFont(&font->stbfont, font->data, 0);
-    if (!ok)
+    for (int32_t i = 0; i < g_workers.thread_count; i++)
     {
-        lite_arena_end_temp(arena_temp);
-        return nullptr;
+        lite_thread_join(g_workers.threads[i]);
     }
 
-    /* get height and scale */
-    int32_t ascent, descent, linegap;
-    stbtt_GetFontVMetrics(&font->stbfont, &ascent, &descent, &linegap);
-    float scale  = stbtt_ScaleForMappingEmToPixels(&font->stbfont, size);
-    font->height = (int32_t)((ascent - descent + linegap) * scale + 0.5f);
-
-    /* make tab and newline glyphs invisible */
-    stbtt_bakedchar* g = get_glyphset(font, '\n')->glyphs;
-    g['\t'].x1         = g['\t'].x0;
-    g['\n'].x1         = g['\n'].x0;
-
-    return font;
+    lite_condition_destroy(g_workers.done);
+    lite_condition_destroy(g_workers.wake);
+    lite_mutex_destroy(g_workers.mutex);
+    g_workers.mutex        = nullptr;
+    g_workers.wake         = nullptr;
+    g_workers.done         = nullptr;
+    g_workers.thread_count = 0;
 }
 
 
-void lite_free_font(LiteFont* font)
+void lite_renderer_init(void)
 {
-    for (int32_t i = 0; i < MAX_GLYPHSET; i++)
-    {
-        LiteGlyphSet* set = font->sets[i];
-        if (set)
-        {
-            lite_free_image(set->image);
-            free(set);
-        }
-    }
+    g_recording_thread = true;
 
-	// @note(maihd): font now use LiteArena, so there no need to free
-    //free(font->data);
-    //free(font);
-}
+    g_draw_lock       = lite_mutex_create();
+    g_surface.pixels  = (LiteColor*)lite_window_surface(
+        &g_surface.width, &g_surface.height
+    );
 
+    lite_renderer_set_clip_rect((LiteRect){
+                                    .x = 0,
+                                    .y = 0,
+                                    .width = g_surface.width,
+                                    .height = g_surface.height
+                                });
 
-void lite_set_font_tab_width(LiteFont* font, int32_t n)
-{
-    LiteGlyphSet* set = get_glyphset(font, '\t');
-    set->glyphs['\t'].xadvance = (float)n;
+    init_pixel_kernels();
+    init_workers();
+    init_rasterizer();
 }
 
 
-int32_t lite_get_font_tab_width(LiteFont* font)
+void lite_renderer_deinit(void)
 {
-    LiteGlyphSet* set = get_glyphset(font, '\t');
-    return (int32_t)set->glyphs['\t'].xadvance;
+    deinit_rasterizer();
+    deinit_workers();
+
+    lite_mutex_destroy(g_draw_lock);
+    g_draw_lock = nullptr;
+
+    free(g_glyph_cache_dir);
+    g_glyph_cache_dir = nullptr;
+
+    assert(g_memory.images == 0 && "Leak image in renderer");
+    assert(g_memory.fonts == 0 && g_faces == nullptr && "Leak font in renderer");
 }
 
 
-int32_t lite_get_font_width(LiteFont* font, LiteStringView text)
+void lite_renderer_update_rects(LiteRect* rects, int32_t count)
 {
-    int32_t			x = 0;
-    LiteStringView	p = text;
-    unsigned		codepoint;
-    while (p.length > 0)
-    {
-        p                    = utf8_to_codepoint(p, &codepoint);
-        LiteGlyphSet*    set = get_glyphset(font, codepoint);
-        stbtt_bakedchar* g   = &set->glyphs[codepoint & 0xff];
+    lite_renderer_lock_surface();
+    lite_window_update_rects(rects, (uint32_t)count);
+    lite_renderer_unlock_surface();
 
-        x += (int32_t)g->xadvance;
+    static bool initial_frame = true;
+    if (initial_frame)
+    {
+        lite_window_show();
+        initial_frame = false;
     }
-    return x;
 }
 
 
-int32_t lite_get_font_height(LiteFont* font)
+void lite_renderer_set_clip_rect(LiteRect rect)
 {
-    return font->height;
+    g_context.clip.left   = rect.x;
+    g_context.clip.top    = rect.y;
+    g_context.clip.right  = rect.x + rect.width;
+    g_context.clip.bottom = rect.y + rect.height;
 }
 
 
-static inline LiteColor blend_pixel(LiteColor dst, LiteColor src)
+void lite_renderer_scroll_rect(LiteRect rect, int32_t dy)
 {
-    int32_t ia = 0xff - src.a;
-    dst.r      = ((src.r * src.a) + (dst.r * ia)) >> 8;
-    dst.g      = ((src.g * src.a) + (dst.g * ia)) >> 8;
-    dst.b      = ((src.b * src.a) + (dst.b * ia)) >> 8;
-    return dst;
-}
+    lite_renderer_lock_surface();
+    g_surface.pixels  = (LiteColor*)lite_window_surface(
+        &g_surface.width, &g_surface.height
+    );
 
+    int32_t x1 = rect.x < 0 ? 0 : rect.x;
+    int32_t y1 = rect.y < 0 ? 0 : rect.y;
+    int32_t x2 = rect.x + rect.width;
+    int32_t y2 = rect.y + rect.height;
+    x2         = x2 > g_surface.width ? g_surface.width : x2;
+    y2         = y2 > g_surface.height ? g_surface.height : y2;
+    if (x2 <= x1 || y2 - y1 <= abs(dy))
+    {
+        lite_renderer_unlock_surface();
+        return;
+    }
 
-static inline LiteColor blend_pixel2(LiteColor dst, LiteColor src, LiteColor color)
-{
-    src.a      = (src.a * color.a) >> 8;
-    uint8_t ia = 0xff - src.a;
-    dst.r      = ((src.r * color.r * src.a) >> 16) + ((dst.r * ia) >> 8);
-    dst.g      = ((src.g * color.g * src.a) >> 16) + ((dst.g * ia) >> 8);
-    dst.b      = ((src.b * color.b * src.a) >> 16) + ((dst.b * ia) >> 8);
-    return dst;
+    /* rows move towards dy, walk them so no source row is overwritten first */
+    size_t  row_size = (x2 - x1) * sizeof(LiteColor);
+    int32_t first    = dy > 0 ? y2 - 1 - dy : y1 - dy;
+    int32_t last     = dy > 0 ? y1 - 1 : y2;
+    int32_t step     = dy > 0 ? -1 : 1;
+    for (int32_t y = first; y != last; y += step)
+    {
+        LiteColor* src = g_surface.pixels + x1 + y * g_surface.width;
+        memcpy(src + dy * g_surface.width, src, row_size);
+    }
+    lite_renderer_unlock_surface();
 }
 
 
-#define rect_draw_loop(expr)                                                   \
-    for (int32_t j = y1; j < y2; j++)                                          \
-    {                                                                          \
-        for (int32_t i = x1; i < x2; i++)                                      \
-        {                                                                      \
-            *d = expr;                                                         \
-            d++;                                                               \
-        }                                                                      \
-        d += dr;                                                               \
-    }
+LiteRendererStats lite_renderer_take_stats(void)
+{
+    // @note(maihd): workers only flush while draw_regions waits for them, so
+    //     the thread calling draw_regions owns g_stats here
+    flush_context_stats();
+
+    LiteRendererStats stats = g_stats;
+    g_stats                 = (LiteRendererStats){0};
+    return stats;
+}
 
 
-void lite_draw_rect(LiteRect rect, LiteColor color)
+int32_t lite_renderer_worker_count(void)
 {
-    if (color.a == 0)
-    {
-        return;
-    }
+    return g_workers.thread_count + 1;
+}
 
-    int32_t x1 = rect.x < clip.left ? clip.left : rect.x;
-    int32_t y1 = rect.y < clip.top ? clip.top : rect.y;
-    int32_t x2 = rect.x + rect.width;
-    int32_t y2 = rect.y + rect.height;
-    x2         = x2 > clip.right ? clip.right : x2;
-    y2         = y2 > clip.bottom ? clip.bottom : y2;
 
-    // @note(maihd): trick, need to handle resize event instead
+void lite_renderer_draw_regions(const LiteRect* regions, int32_t count,
+                                LiteRegionDrawFunc* func, void* userdata)
+{
+    // @note(maihd): the window surface may be recreated on resize, refresh it
+    //     here under the draw lock, workers only ever see this snapshot
+    lite_renderer_lock_surface();
     g_surface.pixels  = (LiteColor*)lite_window_surface(
         &g_surface.width, &g_surface.height
     );
 
-    LiteColor* d = g_surface.pixels;
-    d += x1 + y1 * g_surface.width;
-    int32_t dr = g_surface.width - (x2 - x1);
+    int64_t pixels = 0;
+    for (int32_t i = 0; i < count; i++)
+    {
+        pixels += (int64_t)regions[i].width * regions[i].height;
+    }
 
-    if (color.a == 0xff)
+    if (g_workers.thread_count == 0 || count < 2 || pixels < PARALLEL_MIN_PIXELS)
     {
-        rect_draw_loop(color);
+        for (int32_t i = 0; i < count; i++)
+        {
+            LiteRect region = regions[i];
+            if (clamp_to_surface(&region))
+            {
+                lite_renderer_set_clip_rect(region);
+                func(userdata, region, 0);
+            }
+        }
+        lite_atomic_add(&g_glyph_epoch, 1);
+        lite_renderer_unlock_surface();
+        return;
     }
-    else
+
+    lite_mutex_lock(g_workers.mutex);
+    g_workers.regions      = regions;
+    g_workers.region_count = count;
+    g_workers.next_region  = 0;
+    g_workers.func         = func;
+    g_workers.userdata     = userdata;
+    g_workers.running      = g_workers.thread_count;
+    g_workers.generation++;
+    lite_condition_broadcast(g_workers.wake);
+    lite_mutex_unlock(g_workers.mutex);
+
+    draw_worker_regions(0);
+
+    /* join before the caller presents the regions */
+    lite_mutex_lock(g_workers.mutex);
+    while (g_workers.running > 0)
     {
-        rect_draw_loop(blend_pixel(*d, color));
+        lite_condition_wait(g_workers.done, g_workers.mutex);
     }
-}
+    lite_mutex_unlock(g_workers.mutex);
+    lite_atomic_add(&g_glyph_epoch, 1);
+    lite_renderer_unlock_surface();
 
+    lite_renderer_set_clip_rect((LiteRect){
+                                    .x = 0,
+                                    .y = 0,
+                                    .width = g_surface.width,
+                                    .height = g_surface.height
+                                });
+}
+
+
+void lite_renderer_lock_surface(void)
+{
+    if (g_draw_lock && g_draw_lock_depth++ == 0)
+    {
+        lite_mutex_lock(g_draw_lock);
+    }
+}
+
+
+/* take the surface lock unless a frame is being drawn with it */
+static bool try_lock_surface(void)
+{
+    if (g_draw_lock == nullptr)
+    {
+        return true;
+    }
+
+    if (g_draw_lock_depth == 0 && !lite_mutex_try_lock(g_draw_lock))
+    {
+        return false;
+    }
+    g_draw_lock_depth++;
+    return true;
+}
+
+
+void lite_renderer_unlock_surface(void)
+{
+    if (g_draw_lock && --g_draw_lock_depth == 0)
+    {
+        lite_mutex_unlock(g_draw_lock);
+    }
+}
+
+
+void lite_renderer_get_size(int32_t* x, int32_t* y)
+{
+    assert(x);
+    assert(y);
+
+    lite_window_surface(x, y);
+}
+
+
+LiteImage* lite_new_image(int32_t width, int32_t height)
+{
+    assert(width > 0 && height > 0);
+
+    size_t     bytes = (size_t)width * height * sizeof(LiteColor);
+    LiteImage* image = check_alloc(malloc(sizeof(LiteImage) + bytes));
+    image->pixels    = (LiteColor*)(image + 1);
+    image->width     = width;
+    image->height    = height;
+
+    g_memory.images++;
+    g_memory.image_bytes += (int64_t)bytes;
+    return image;
+}
+
+
+void lite_free_image(LiteImage* image)
+{
+    if (image)
+    {
+        g_memory.images--;
+        g_memory.image_bytes -= (int64_t)image->width * image->height * sizeof(LiteColor);
+        free(image);
+    }
+}
+
+
+LiteRendererMemory lite_renderer_get_memory(void)
+{
+    return g_memory;
+}
+
+
+static void skyline_reset(LiteGlyphPage* page, int32_t size)
+{
+    page->nodes[0]   = (LiteSkylineNode){ .x = 0, .y = 0, .width = size };
+    page->node_count = 1;
+}
+
+
+/* lowest y a width x height rect can sit at starting on node i, -1 if none */
+static int32_t skyline_fit(const LiteGlyphPage* page, int32_t size, int32_t i, int32_t width, int32_t height)
+{
+    if (page->nodes[i].x + width > size)
+    {
+        return -1;
+    }
+
+    int32_t y         = 0;
+    int32_t remaining = width;
+    for (; remaining > 0; i++)
+    {
+        y          = page->nodes[i].y > y ? page->nodes[i].y : y;
+        remaining -= page->nodes[i].width;
+        if (y + height > size)
+        {
+            return -1;
+        }
+    }
+    return y;
+}
+
+
+static bool skyline_pack(LiteGlyphPage* page, int32_t size, int32_t width, int32_t height, int32_t* x, int32_t* y)
+{
+    /* bottom-left: the lowest top edge, then the narrowest node */
+    int32_t best      = -1;
+    int32_t best_y    = size;
+    int32_t best_node = size;
+    for (int32_t i = 0; i < page->node_count; i++)
+    {
+        int32_t fit = skyline_fit(page, size, i, width, height);
+        if (fit >= 0 && (fit + height < best_y || (fit + height == best_y && page->nodes[i].width < best_node)))
+        {
+            best      = i;
+            best_y    = fit + height;
+            best_node = page->nodes[i].width;
+        }
+    }
+
+    if (best < 0)
+    {
+        return false;
+    }
+
+    *x = page->nodes[best].x;
+    *y = best_y - height;
+
+    /* raise the skyline over the new rect and trim the nodes it covers */
+    LiteSkylineNode* nodes = page->nodes;
+    memmove(nodes + best + 1, nodes + best, (page->node_count - best) * sizeof(*nodes));
+    nodes[best] = (LiteSkylineNode){ .x = *x, .y = best_y, .width = width };
+    page->node_count++;
+
+    for (int32_t i = best + 1; i < page->node_count; i++)
+    {
+        int32_t shrink = nodes[i - 1].x + nodes[i - 1].width - nodes[i].x;
+        if (shrink <= 0)
+        {
+            break;
+        }
+
+        nodes[i].x     += shrink;
+        nodes[i].width -= shrink;
+        if (nodes[i].width > 0)
+        {
+            break;
+        }
+
+        memmove(nodes + i, nodes + i + 1, (page->node_count - i - 1) * sizeof(*nodes));
+        page->node_count--;
+        i--;
+    }
+
+    for (int32_t i = 0; i + 1 < page->node_count; i++)
+    {
+        if (nodes[i].y == nodes[i + 1].y)
+        {
+            nodes[i].width += nodes[i + 1].width;
+            memmove(nodes + i + 1, nodes + i + 2, (page->node_count - i - 2) * sizeof(*nodes));
+            page->node_count--;
+            i--;
+        }
+    }
+
+    return true;
+}
+
+
+static inline uint32_t glyph_hash(uint32_t codepoint)
+{
+    return codepoint * 2654435761u;
+}
+
+
+static void insert_glyph_map(LiteFont* font, int32_t index)
+{
+    uint32_t codepoint = font->glyphs[index].codepoint;
+    if (codepoint < 128)
+    {
+        font->ascii[codepoint] = index + 1;
+        return;
+    }
+
+    uint32_t slot = glyph_hash(codepoint) & font->map_mask;
+    while (font->map[slot] != 0)
+    {
+        slot = (slot + 1) & font->map_mask;
+    }
+    font->map[slot] = index + 1;
+}
+
+
+static void rebuild_glyph_map(LiteFont* font, uint32_t capacity)
+{
+    if (capacity - 1 != font->map_mask)
+    {
+        free(font->map);
+        font->map      = check_alloc(malloc(capacity * sizeof(*font->map)));
+        font->map_mask = capacity - 1;
+    }
+
+    memset(font->map, 0, capacity * sizeof(*font->map));
+    memset(font->ascii, 0, sizeof(font->ascii));
+    for (int32_t i = 0; i < font->glyph_count; i++)
+    {
+        insert_glyph_map(font, i);
+    }
+}
+
+
+static LiteGlyph* find_glyph(const LiteFont* font, uint32_t codepoint)
+{
+    if (codepoint < 128)
+    {
+        int32_t index = font->ascii[codepoint];
+        return index ? &font->glyphs[index - 1] : nullptr;
+    }
+
+    uint32_t slot = glyph_hash(codepoint) & font->map_mask;
+    for (;;)
+    {
+        int32_t index = font->map[slot];
+        if (index == 0)
+        {
+            return nullptr;
+        }
+
+        if (font->glyphs[index - 1].codepoint == codepoint)
+        {
+            return &font->glyphs[index - 1];
+        }
+        slot = (slot + 1) & font->map_mask;
+    }
+}
+
+
+/* drop the least recently used page not drawn from since the frame before
+** last and forget its glyphs, -1 when every page is still in use */
+static int32_t evict_glyph_page(LiteFont* font)
+{
+    uint32_t epoch  = glyph_epoch();
+    int32_t  victim = -1;
+    for (int32_t i = 0; i < font->page_count; i++)
+    {
+        uint32_t last_used = font->pages[i].last_used;
+        if (epoch - last_used > 1 && (victim < 0 || last_used < font->pages[victim].last_used))
+        {
+            victim = i;
+        }
+    }
+
+    if (victim < 0)
+    {
+        return -1;
+    }
+
+    int32_t kept = 0;
+    for (int32_t i = 0; i < font->glyph_count; i++)
+    {
+        if (font->glyphs[i].page != victim)
+        {
+            font->glyphs[kept++] = font->glyphs[i];
+        }
+    }
+    font->glyph_count = kept;
+    rebuild_glyph_map(font, font->map_mask + 1);
+
+    LiteGlyphPage* page = &font->pages[victim];
+    memset(page->coverage, 0, (size_t)font->page_size * font->page_size);
+    skyline_reset(page, font->page_size);
+    return victim;
+}
+
+
+static int32_t add_glyph_page(LiteFont* font)
+{
+    size_t page_bytes = (size_t)font->page_size * font->page_size;
+    if ((size_t)(font->page_count + 1) * page_bytes > g_glyph_budget)
+    {
+        int32_t page = evict_glyph_page(font);
+        if (page >= 0)
+        {
+            return page;
+        }
+    }
+
+    font->pages = check_alloc(realloc(font->pages, (font->page_count + 1) * sizeof(*font->pages)));
+
+    LiteGlyphPage* page = &font->pages[font->page_count];
+    page->coverage      = check_alloc(calloc(1, page_bytes));
+    page->nodes         = check_alloc(malloc((font->page_size + 1) * sizeof(*page->nodes)));
+    page->last_used     = glyph_epoch();
+    skyline_reset(page, font->page_size);
+
+    g_memory.atlas_bytes += (int64_t)page_bytes;
+    return font->page_count++;
+}
+
+
+/* place a width x height rect, newest pages first since older ones are full */
+static int32_t alloc_glyph_rect(LiteFont* font, int32_t width, int32_t height, int32_t* x, int32_t* y)
+{
+    for (int32_t i = font->page_count - 1; i >= 0; i--)
+    {
+        if (skyline_pack(&font->pages[i], font->page_size, width, height, x, y))
+        {
+            return i;
+        }
+    }
+
+    int32_t page = add_glyph_page(font);
+    return skyline_pack(&font->pages[page], font->page_size, width, height, x, y) ? page : -1;
+}
+
+
+static LiteGlyph* get_glyph(LiteFont* font, uint32_t codepoint);
+static void save_glyph_cache(LiteFont* font);
+
+
+static void push_glyph_job(LiteGlyphJob** jobs, int32_t* count, int32_t* capacity, LiteGlyphJob job)
+{
+    if (*count == *capacity)
+    {
+        *capacity = *capacity ? *capacity * 2 : 128;
+        *jobs     = check_alloc(realloc(*jobs, *capacity * sizeof(**jobs)));
+    }
+    (*jobs)[(*count)++] = job;
+}
+
+
+/* rasterize a glyph's coverage, or its distance field for reference fonts */
+static void rasterize_glyph(const LiteFont* font, int32_t index, uint8_t* dst, int32_t width, int32_t height, int32_t stride)
+{
+    if (!font->distance_field)
+    {
+        stbtt_MakeGlyphBitmap(&font->face->stbfont, dst, width, height, stride, font->scale, font->scale, index);
+        return;
+    }
+
+    int      w, h;
+    uint8_t* field = stbtt_GetGlyphSDF(&font->face->stbfont, font->scale, index, SDF_PADDING, SDF_ON_EDGE,
+                                       SDF_DISTANCE_SCALE, &w, &h, nullptr, nullptr);
+    if (field)
+    {
+        for (int32_t j = 0; j < height && j < h; j++)
+        {
+            memcpy(dst + j * stride, field + j * w, width < w ? width : w);
+        }
+        stbtt_FreeSDF(field, nullptr);
+    }
+}
+
+
+static int32_t rasterizer_main(void* userdata)
+{
+    (void)userdata;
+
+    lite_mutex_lock(g_rasterizer.mutex);
+    for (;;)
+    {
+        while (!g_rasterizer.quit && g_rasterizer.queue_head == g_rasterizer.queue_count)
+        {
+            lite_condition_wait(g_rasterizer.wake, g_rasterizer.mutex);
+        }
+
+        if (g_rasterizer.quit)
+        {
+            break;
+        }
+
+        LiteGlyphJob job = g_rasterizer.queue[g_rasterizer.queue_head++];
+        if (g_rasterizer.queue_head == g_rasterizer.queue_count)
+        {
+            g_rasterizer.queue_head  = 0;
+            g_rasterizer.queue_count = 0;
+        }
+        g_rasterizer.busy = job.font;
+        lite_mutex_unlock(g_rasterizer.mutex);
+
+        /* the font is only read here, lite_free_font waits for the job */
+        job.coverage = check_alloc(malloc((size_t)job.width * job.height));
+        rasterize_glyph(job.font, job.index, job.coverage, job.width, job.height, job.width);
+
+        lite_mutex_lock(g_rasterizer.mutex);
+        g_rasterizer.busy = nullptr;
+        push_glyph_job(&g_rasterizer.done, &g_rasterizer.done_count, &g_rasterizer.done_capacity, job);
+        lite_condition_broadcast(g_rasterizer.idle);
+    }
+    lite_mutex_unlock(g_rasterizer.mutex);
+
+    return 0;
+}
+
+
+static void init_rasterizer(void)
+{
+    g_rasterizer.mutex  = lite_mutex_create();
+    g_rasterizer.wake   = lite_condition_create();
+    g_rasterizer.idle   = lite_condition_create();
+    g_rasterizer.quit   = false;
+    g_rasterizer.thread = lite_thread_create(rasterizer_main, "lite-glyphs", nullptr);
+
+    /* glyphs are rasterized in place when there is no thread */
+}
+
+
+static void deinit_rasterizer(void)
+{
+    if (g_rasterizer.thread)
+    {
+        lite_mutex_lock(g_rasterizer.mutex);
+        g_rasterizer.quit = true;
+        lite_condition_broadcast(g_rasterizer.wake);
+        lite_mutex_unlock(g_rasterizer.mutex);
+        lite_thread_join(g_rasterizer.thread);
+    }
+
+    for (int32_t i = 0; i < g_rasterizer.done_count; i++)
+    {
+        free(g_rasterizer.done[i].coverage);
+    }
+    free(g_rasterizer.queue);
+    free(g_rasterizer.done);
+
+    lite_condition_destroy(g_rasterizer.idle);
+    lite_condition_destroy(g_rasterizer.wake);
+    lite_mutex_destroy(g_rasterizer.mutex);
+    memset(&g_rasterizer, 0, sizeof(g_rasterizer));
+}
+
+
+static void queue_glyph_job(LiteGlyphJob job)
+{
+    lite_mutex_lock(g_rasterizer.mutex);
+    push_glyph_job(&g_rasterizer.queue, &g_rasterizer.queue_count, &g_rasterizer.queue_capacity, job);
+    lite_condition_signal(g_rasterizer.wake);
+    lite_mutex_unlock(g_rasterizer.mutex);
+}
+
+
+/* drop the jobs of a font about to be freed, waiting out the one running */
+static void cancel_glyph_jobs(LiteFont* font)
+{
+    if (g_rasterizer.thread == nullptr)
+    {
+        return;
+    }
+
+    lite_mutex_lock(g_rasterizer.mutex);
+    int32_t kept = g_rasterizer.queue_head;
+    for (int32_t i = g_rasterizer.queue_head; i < g_rasterizer.queue_count; i++)
+    {
+        if (g_rasterizer.queue[i].font != font)
+        {
+            g_rasterizer.queue[kept++] = g_rasterizer.queue[i];
+        }
+    }
+    g_rasterizer.queue_count = kept;
+
+    while (g_rasterizer.busy == font)
+    {
+        lite_condition_wait(g_rasterizer.idle, g_rasterizer.mutex);
+    }
+
+    kept = 0;
+    for (int32_t i = 0; i < g_rasterizer.done_count; i++)
+    {
+        if (g_rasterizer.done[i].font != font)
+        {
+            g_rasterizer.done[kept++] = g_rasterizer.done[i];
+        }
+        else
+        {
+            free(g_rasterizer.done[i].coverage);
+        }
+    }
+    g_rasterizer.done_count = kept;
+    lite_mutex_unlock(g_rasterizer.mutex);
+}
+
+
+static void finish_glyph(LiteFont* font, LiteGlyph* glyph, int32_t page, int32_t x, int32_t y)
+{
+    glyph->pending = false;
+    glyph->page    = page;
+    glyph->x       = x;
+    glyph->y       = y;
+    if (page < 0)
+    {
+        glyph->width  = 0;
+        glyph->height = 0;
+    }
+    font->pending_count--;
+
+    if (font->cache_miss && font->pending_count == 0)
+    {
+        save_glyph_cache(font);
+    }
+}
+
+
+static void install_glyph(const LiteGlyphJob* job)
+{
+    LiteFont* font = job->font;
+
+    /* packing may evict a page, so glyphs are looked up after it */
+    int32_t x, y;
+    int32_t page = alloc_glyph_rect(font, job->width, job->height, &x, &y);
+    if (page >= 0)
+    {
+        /* drawn this frame, the page must outlive the rest of the installs */
+        uint8_t* coverage = font->pages[page].coverage + x + y * font->page_size;
+        for (int32_t j = 0; j < job->height; j++)
+        {
+            memcpy(coverage + j * font->page_size, job->coverage + j * job->width, job->width);
+        }
+        font->pages[page].last_used = glyph_epoch();
+    }
+
+    if (job->index != 0)
+    {
+        finish_glyph(font, find_glyph(font, job->codepoint), page, x, y);
+        return;
+    }
+
+    /* the missing glyph is shared by every codepoint the font lacks */
+    for (int32_t i = 0; i < font->glyph_count; i++)
+    {
+        if (font->glyphs[i].pending && font->glyphs[i].index == 0)
+        {
+            finish_glyph(font, &font->glyphs[i], page, x, y);
+        }
+    }
+}
+
+
+static void append_glyph(LiteFont* font, LiteGlyph glyph)
+{
+    if (font->glyph_count == font->glyph_capacity)
+    {
+        font->glyph_capacity = font->glyph_capacity ? font->glyph_capacity * 2 : 256;
+        font->glyphs         = check_alloc(realloc(font->glyphs, font->glyph_capacity * sizeof(*font->glyphs)));
+    }
+    font->glyphs[font->glyph_count++] = glyph;
+
+    /* keep the map at most half full */
+    if ((uint32_t)font->glyph_count * 2 > font->map_mask + 1)
+    {
+        rebuild_glyph_map(font, (font->map_mask + 1) * 2);
+    }
+    else
+    {
+        insert_glyph_map(font, font->glyph_count - 1);
+    }
+}
+
+
+/* the metrics of a glyph, read from the face alone */
+static LiteGlyph measure_glyph(const LiteFont* font, uint32_t codepoint, int32_t index)
+{
+    int32_t advance, lsb, x0, y0, x1, y1;
+    stbtt_GetGlyphHMetrics(&font->face->stbfont, index, &advance, &lsb);
+    stbtt_GetGlyphBitmapBox(&font->face->stbfont, index, font->scale, font->scale, &x0, &y0, &x1, &y1);
+
+    LiteGlyph glyph = {
+        .codepoint = codepoint,
+        .index     = index,
+        .page      = -1,
+        .width     = x1 - x0,
+        .height    = y1 - y0,
+        .xoff      = x0,
+        .yoff      = y0 + font->ascent,
+        .xadvance  = (int32_t)floorf(font->scale * advance),
+    };
+
+    /* distance fields reach past the outline by the padding */
+    if (font->distance_field && glyph.width > 0 && glyph.height > 0)
+    {
+        glyph.width  += 2 * SDF_PADDING;
+        glyph.height += 2 * SDF_PADDING;
+        glyph.xoff   -= SDF_PADDING;
+        glyph.yoff   -= SDF_PADDING;
+    }
+
+    /* tab and newline are invisible, sdf fonts draw the reference glyphs */
+    if (codepoint == '\t' || codepoint == '\n' || font->sdf)
+    {
+        glyph.width = 0;
+    }
+    return glyph;
+}
+
+
+static LiteGlyph* load_glyph(LiteFont* font, uint32_t codepoint)
+{
+    int32_t index = stbtt_FindGlyphIndex(&font->face->stbfont, codepoint);
+
+    /* a file in a script the font lacks would fill pages with copies */
+    if (index == 0 && codepoint != GLYPH_NOTDEF)
+    {
+        LiteGlyph glyph      = *get_glyph(font, GLYPH_NOTDEF);
+        glyph.codepoint      = codepoint;
+        font->pending_count += glyph.pending;
+        append_glyph(font, glyph);
+        return &font->glyphs[font->glyph_count - 1];
+    }
+
+    LiteGlyph glyph = measure_glyph(font, codepoint, index);
+    if (glyph.width > 0 && glyph.height > 0 && g_glyph_async && g_rasterizer.thread)
+    {
+        /* the metrics are ready now, the coverage in a frame or so */
+        glyph.pending = true;
+        font->pending_count++;
+        queue_glyph_job((LiteGlyphJob){
+            .font      = font,
+            .codepoint = codepoint,
+            .index     = index,
+            .width     = glyph.width,
+            .height    = glyph.height,
+        });
+    }
+    else if (glyph.width > 0 && glyph.height > 0)
+    {
+        /* packing may evict a page, which moves glyphs around */
+        glyph.page = alloc_glyph_rect(font, glyph.width, glyph.height, &glyph.x, &glyph.y);
+        if (glyph.page >= 0)
+        {
+            uint8_t* coverage = font->pages[glyph.page].coverage + glyph.x + glyph.y * font->page_size;
+            rasterize_glyph(font, index, coverage, glyph.width, glyph.height, font->page_size);
+        }
+    }
+
+    if (glyph.page < 0 && !glyph.pending)
+    {
+        glyph.width  = 0;
+        glyph.height = 0;
+    }
+
+    append_glyph(font, glyph);
+    return &font->glyphs[font->glyph_count - 1];
+}
+
+
+static LiteGlyph* find_staged_glyph(const LiteFont* font, uint32_t codepoint)
+{
+    for (int32_t i = font->staged_count - 1; i >= 0; i--)
+    {
+        if (font->staged[i].codepoint == codepoint)
+        {
+            return &font->staged[i];
+        }
+    }
+    return nullptr;
+}
+
+
+/* a frame being drawn reads the glyph map and the pages, so a glyph missed
+** meanwhile is only measured, and loaded by lite_poll_glyphs before the
+** frame it was measured for is drawn; it is pending when it will then be
+** rasterized in the background, so its text is redrawn */
+static LiteGlyph* stage_glyph(LiteFont* font, uint32_t codepoint)
+{
+    LiteGlyph* staged = find_staged_glyph(font, codepoint);
+    if (staged)
+    {
+        return staged;
+    }
+
+    if (font->staged_count == 0)
+    {
+        font->next_staged = g_staged_fonts;
+        g_staged_fonts    = font;
+    }
+    if (font->staged_count == font->staged_capacity)
+    {
+        font->staged_capacity = font->staged_capacity ? font->staged_capacity * 2 : 64;
+        font->staged          = check_alloc(realloc(font->staged, font->staged_capacity * sizeof(*font->staged)));
+    }
+
+    LiteGlyph glyph = measure_glyph(font, codepoint, stbtt_FindGlyphIndex(&font->face->stbfont, codepoint));
+    glyph.pending   = glyph.width > 0 && glyph.height > 0 && g_glyph_async && g_rasterizer.thread;
+    font->staged[font->staged_count++] = glyph;
+    return &font->staged[font->staged_count - 1];
+}
+
+
+/* load the staged glyphs, called with the surface lock held */
+static void install_staged_glyphs(void)
+{
+    while (g_staged_fonts)
+    {
+        LiteFont* font = g_staged_fonts;
+        g_staged_fonts = font->next_staged;
+
+        for (int32_t i = 0; i < font->staged_count; i++)
+        {
+            /* drawn in between with the lock free, it was loaded then */
+            if (find_glyph(font, font->staged[i].codepoint) == nullptr)
+            {
+                load_glyph(font, font->staged[i].codepoint);
+            }
+        }
+        font->staged_count = 0;
+        font->next_staged  = nullptr;
+
+        /* rasterized in place when glyphs aren't async, save the cache now */
+        if (font->cache_miss && font->pending_count == 0)
+        {
+            save_glyph_cache(font);
+        }
+    }
+}
+
+
+static void unstage_font(LiteFont* font)
+{
+    if (font->staged_count > 0)
+    {
+        LiteFont** link = &g_staged_fonts;
+        while (*link != font)
+        {
+            link = &(*link)->next_staged;
+        }
+        *link = font->next_staged;
+    }
+    free(font->staged);
+}
+
+
+/* look a glyph up, rasterizing it on a miss, and mark its page as in use
+** @note(maihd): only the recording thread may call this, workers and the
+**     render thread draw with find_draw_glyph instead */
+static LiteGlyph* get_glyph(LiteFont* font, uint32_t codepoint)
+{
+    assert(g_recording_thread && "glyphs are only loaded on the recording thread");
+
+    LiteGlyph* glyph = find_glyph(font, codepoint);
+    if (glyph == nullptr && try_lock_surface())
+    {
+        /* loading may grow the glyph map or evict a page */
+        glyph = load_glyph(font, codepoint);
+        lite_renderer_unlock_surface();
+    }
+    else if (glyph == nullptr)
+    {
+        /* a frame is being drawn, don't wait for it */
+        glyph = stage_glyph(font, codepoint);
+    }
+
+    if (glyph->page >= 0)
+    {
+        font->pages[glyph->page].last_used = glyph_epoch();
+    }
+
+    /* the reference glyph an sdf font draws must stay cached as well */
+    if (font->sdf)
+    {
+        get_glyph(font->sdf, codepoint);
+    }
+    return glyph;
+}
+
+
+// -----------------------------------------------------------------
+// Glyph caches: the ascii block of each font is kept on disk between
+// runs, keyed by a hash of the font file, the size and the rasterizer,
+// so the first frame doesn't wait for it to be rasterized again
+// -----------------------------------------------------------------
+
+/* bump the version whenever rasterization or the layout below changes */
+#define GLYPH_CACHE_MAGIC 0x434c474cu // "LGLC"
+enum { GLYPH_CACHE_VERSION = 1 };
+
+
+/* the file is a header, its records, then the coverage of every record
+** with pixels in record order; the missing glyph comes first, codepoints
+** the font lacks are stored as copies of it without coverage */
+typedef struct LiteGlyphCacheHeader
+{
+    uint32_t            magic;
+    uint32_t            version;
+    uint64_t            face_hash;
+    float               size;
+    int32_t             distance_field;
+    int32_t             count;
+} LiteGlyphCacheHeader;
+
+
+typedef struct LiteGlyphCacheRecord
+{
+    uint32_t            codepoint;
+    int32_t             index;
+    int32_t             width, height;
+    int32_t             xoff, yoff;
+    int32_t             xadvance;
+} LiteGlyphCacheRecord;
+
+
+static bool glyph_cache_path(LiteFont* font, char* path, size_t size)
+{
+    if (g_glyph_cache_dir == nullptr)
+    {
+        return false;
+    }
+
+    /* fnv-1a, once per face */
+    LiteFontFace* face = font->face;
+    if (face->hash == 0)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < face->data_size; i++)
+        {
+            hash = (hash ^ face->data[i]) * 1099511628211ull;
+        }
+        face->hash = hash ? hash : 1;
+    }
+
+    uint32_t size_bits;
+    memcpy(&size_bits, &font->size, sizeof(size_bits));
+    int length = snprintf(path, size, "%s/%016llx-%08x%s.glyphs", g_glyph_cache_dir,
+                          (unsigned long long)face->hash, size_bits, font->distance_field ? "-sdf" : "");
+    return length > 0 && (size_t)length < size;
+}
+
+
+static bool is_glyph_copy(uint32_t codepoint, int32_t index)
+{
+    return index == 0 && codepoint != GLYPH_NOTDEF;
+}
+
+
+/* install the cached glyphs into a font that has none yet */
+static bool load_glyph_cache(LiteFont* font)
+{
+    char path[1024];
+    if (!glyph_cache_path(font, path, sizeof(path)))
+    {
+        return false;
+    }
+
+    size_t         size;
+    const uint8_t* data = lite_map_file(path, &size);
+    if (data == nullptr)
+    {
+        return false;
+    }
+
+    LiteGlyphCacheHeader header = {0};
+    if (size >= sizeof(header))
+    {
+        memcpy(&header, data, sizeof(header));
+    }
+
+    bool valid = header.magic == GLYPH_CACHE_MAGIC && header.version == GLYPH_CACHE_VERSION
+              && header.face_hash == font->face->hash && header.size == font->size
+              && header.distance_field == font->distance_field
+              && header.count > 0 && header.count <= 256;
+
+    /* check every record and its coverage fit before touching the font */
+    const uint8_t* records  = data + sizeof(header);
+    size_t         coverage = sizeof(header) + (valid ? header.count * sizeof(LiteGlyphCacheRecord) : 0);
+    size_t         end      = coverage;
+    valid                  &= coverage <= size;
+    for (int32_t i = 0; valid && i < header.count; i++)
+    {
+        LiteGlyphCacheRecord record;
+        memcpy(&record, records + i * sizeof(record), sizeof(record));
+        valid = record.width >= 0 && record.height >= 0
+             && record.width <= font->page_size && record.height <= font->page_size;
+        if (!is_glyph_copy(record.codepoint, record.index))
+        {
+            end   += (size_t)record.width * record.height;
+            valid &= end <= size;
+        }
+    }
+
+    for (int32_t i = 0; valid && i < header.count; i++)
+    {
+        LiteGlyphCacheRecord record;
+        memcpy(&record, records + i * sizeof(record), sizeof(record));
+
+        LiteGlyph glyph = {
+            .codepoint = record.codepoint,
+            .index     = record.index,
+            .page      = -1,
+            .width     = record.width,
+            .height    = record.height,
+            .xoff      = record.xoff,
+            .yoff      = record.yoff,
+            .xadvance  = record.xadvance,
+        };
+
+        if (is_glyph_copy(record.codepoint, record.index))
+        {
+            const LiteGlyph* notdef = find_glyph(font, GLYPH_NOTDEF);
+            glyph.width             = 0;
+            if (notdef)
+            {
+                glyph           = *notdef;
+                glyph.codepoint = record.codepoint;
+            }
+        }
+        else if (glyph.width > 0 && glyph.height > 0)
+        {
+            glyph.page = alloc_glyph_rect(font, glyph.width, glyph.height, &glyph.x, &glyph.y);
+            if (glyph.page >= 0)
+            {
+                uint8_t* dst = font->pages[glyph.page].coverage + glyph.x + glyph.y * font->page_size;
+                for (int32_t j = 0; j < glyph.height; j++)
+                {
+                    memcpy(dst + j * font->page_size, data + coverage + j * glyph.width, glyph.width);
+                }
+            }
+            coverage += (size_t)glyph.width * glyph.height;
+        }
+
+        if (glyph.page < 0)
+        {
+            glyph.width  = 0;
+            glyph.height = 0;
+        }
+        append_glyph(font, glyph);
+    }
+
+    lite_unmap_file(data, size);
+    return valid;
+}
+
+
+/* write the ascii block once all of it is rasterized, a temporary file is
+** renamed over the cache so readers never see half of one */
+static void save_glyph_cache(LiteFont* font)
+{
+    const LiteGlyph* glyphs[129];
+    int32_t          count  = 0;
+    const LiteGlyph* notdef = find_glyph(font, GLYPH_NOTDEF);
+    if (notdef)
+    {
+        glyphs[count++] = notdef;
+    }
+    for (uint32_t codepoint = 0; codepoint < 128; codepoint++)
+    {
+        const LiteGlyph* glyph = find_glyph(font, codepoint);
+        if (glyph == nullptr || glyph->pending)
+        {
+            return;
+        }
+        glyphs[count++] = glyph;
+    }
+
+    font->cache_miss = false;
+
+    char path[1024], temp[1040];
+    if (!glyph_cache_path(font, path, sizeof(path)))
+    {
+        return;
+    }
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    FILE* fp = fopen(temp, "wb");
+    if (fp == nullptr)
+    {
+        return;
+    }
+
+    LiteGlyphCacheHeader header = {
+        .magic          = GLYPH_CACHE_MAGIC,
+        .version        = GLYPH_CACHE_VERSION,
+        .face_hash      = font->face->hash,
+        .size           = font->size,
+        .distance_field = font->distance_field,
+        .count          = count,
+    };
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    for (int32_t i = 0; ok && i < count; i++)
+    {
+        LiteGlyphCacheRecord record = {
+            .codepoint = glyphs[i]->codepoint,
+            .index     = glyphs[i]->index,
+            .width     = glyphs[i]->width,
+            .height    = glyphs[i]->height,
+            .xoff      = glyphs[i]->xoff,
+            .yoff      = glyphs[i]->yoff,
+            .xadvance  = glyphs[i]->xadvance,
+        };
+        ok = fwrite(&record, sizeof(record), 1, fp) == 1;
+    }
+
+    for (int32_t i = 0; ok && i < count; i++)
+    {
+        const LiteGlyph* glyph = glyphs[i];
+        if (is_glyph_copy(glyph->codepoint, glyph->index) || glyph->page < 0)
+        {
+            continue;
+        }
+
+        const uint8_t* src = font->pages[glyph->page].coverage + glyph->x + glyph->y * font->page_size;
+        for (int32_t j = 0; ok && j < glyph->height; j++)
+        {
+            ok = fwrite(src + j * font->page_size, 1, glyph->width, fp) == (size_t)glyph->width;
+        }
+    }
+
+    ok &= fclose(fp) == 0;
+    if (ok)
+    {
+        remove(path);
+        ok = rename(temp, path) == 0;
+    }
+    if (!ok)
+    {
+        remove(temp);
+    }
+}
+
+
+/* use the cached glyphs of a new font, or write them once it has its own */
+static void open_glyph_cache(LiteFont* font)
+{
+    if (g_glyph_cache_dir && !load_glyph_cache(font))
+    {
+        font->cache_miss = true;
+    }
+}
+
+
+void lite_set_glyph_cache_dir(LiteStringView path)
+{
+    free(g_glyph_cache_dir);
+    g_glyph_cache_dir = nullptr;
+
+    if (path.length > 0)
+    {
+        g_glyph_cache_dir = check_alloc(malloc(path.length + 1));
+        memcpy(g_glyph_cache_dir, path.buffer, path.length);
+        g_glyph_cache_dir[path.length] = '\0';
+    }
+}
+
+
+static LiteFontFace* acquire_face(LiteStringView filename)
+{
+    for (LiteFontFace* face = g_faces; face; face = face->next)
+    {
+        if (face->filename.length == filename.length
+            && memcmp(face->filename.buffer, filename.buffer, filename.length) == 0)
+        {
+            face->refs++;
+            return face;
+        }
+    }
+
+    /* lite_map_file wants a nul-terminated path, keep it with the face, render
+    ** traces refer to fonts by it */
+    LiteFontFace* face = check_alloc(calloc(1, sizeof(LiteFontFace) + filename.length + 1));
+    char*         name = (char*)(face + 1);
+    memcpy(name, filename.buffer, filename.length);
+    face->filename = lite_string_view(name, filename.length);
+
+    face->data = lite_map_file(name, &face->data_size);
+    if (face->data == nullptr || !stbtt_InitFont(&face->stbfont, face->data, 0))
+    {
+        if (face->data)
+        {
+            lite_unmap_file(face->data, face->data_size);
+        }
+        free(face);
+        return nullptr;
+    }
+
+    face->refs = 1;
+    face->next = g_faces;
+    g_faces    = face;
+
+    g_memory.faces++;
+    g_memory.face_bytes += (int64_t)face->data_size;
+    return face;
+}
+
+
+static LiteFont* create_font(LiteFontFace* face, float size)
+{
+    LiteFont* font = check_alloc(calloc(1, sizeof(LiteFont)));
+    font->face     = face;
+    font->size     = size;
+
+    /* get height and scale */
+    int32_t ascent, descent, linegap;
+    stbtt_GetFontVMetrics(&face->stbfont, &ascent, &descent, &linegap);
+    float scale  = stbtt_ScaleForMappingEmToPixels(&face->stbfont, size);
+    font->ascent = (int32_t)(ascent * scale + 0.5f);
+    font->height = (int32_t)((ascent - descent + linegap) * scale + 0.5f);
+
+    /* glyphs are rasterized at the em scale, derived the way stb bakes it */
+    float s      = stbtt_ScaleForMappingEmToPixels(&face->stbfont, 1) / stbtt_ScaleForPixelHeight(&face->stbfont, 1);
+    font->scale  = stbtt_ScaleForPixelHeight(&face->stbfont, size * s);
+
+    /* a pixel more on each side for rounding and distance field filtering */
+    int32_t x0, y0, x1, y1;
+    stbtt_GetFontBoundingBox(&face->stbfont, &x0, &y0, &x1, &y1);
+    font->ink_left   = (int32_t)floorf((float)x0 * font->scale) - 1;
+    font->ink_right  = (int32_t)ceilf((float)x1 * font->scale) + 1;
+    font->ink_top    = font->ascent + (int32_t)floorf((float)-y1 * font->scale) - 1;
+    font->ink_bottom = font->ascent + (int32_t)ceilf((float)-y0 * font->scale) + 1;
+
+    /* pages fit a few dozen glyphs of the largest size */
+    font->page_size = GLYPH_PAGE_MIN_SIZE;
+    while (font->page_size < font->height * 8 && font->page_size < GLYPH_PAGE_MAX_SIZE)
+    {
+        font->page_size *= 2;
+    }
+
+    rebuild_glyph_map(font, 256);
+    return font;
+}
+
+
+static void destroy_font(LiteFont* font)
+{
+    cancel_glyph_jobs(font);
+    unstage_font(font);
+
+    for (int32_t i = 0; i < font->page_count; i++)
+    {
+        free(font->pages[i].coverage);
+        free(font->pages[i].nodes);
+    }
+    free(font->pages);
+    free(font->glyphs);
+    free(font->map);
+
+    g_memory.atlas_bytes -= (int64_t)font->page_count * font->page_size * font->page_size;
+    free(font);
+}
+
+
+static void release_face(LiteFontFace* face)
+{
+    if (--face->refs > 0)
+    {
+        return;
+    }
+
+    LiteFontFace** link = &g_faces;
+    while (*link != face)
+    {
+        link = &(*link)->next;
+    }
+    *link = face->next;
+
+    if (face->sdf)
+    {
+        destroy_font(face->sdf);
+    }
+
+    g_memory.faces--;
+    g_memory.face_bytes -= (int64_t)face->data_size;
+    lite_unmap_file(face->data, face->data_size);
+    free(face);
+}
+
+
+/* make an sdf font draw from its face's reference font, mapping distances
+** around the outline to one pixel of antialiasing at its own size */
+static void attach_sdf(LiteFont* font)
+{
+    LiteFontFace* face = font->face;
+    if (face->sdf == nullptr)
+    {
+        face->sdf                 = create_font(face, SDF_REFERENCE_SIZE);
+        face->sdf->distance_field = true;
+        open_glyph_cache(face->sdf);
+    }
+
+    font->sdf = face->sdf;
+
+    float pixels = font->scale / (font->sdf->scale * SDF_DISTANCE_SCALE);
+    for (int32_t i = 0; i < 256; i++)
+    {
+        float t = 0.5f + (float)(i - SDF_ON_EDGE) * pixels;
+        t       = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+        font->sdf_ramp[i] = (uint8_t)(t * t * (3.0f - 2.0f * t) * 255.0f + 0.5f);
+    }
+}
+
+
+LiteFont* lite_load_font(LiteStringView filename, float size)
+{
+    LiteFontFace* face = acquire_face(filename);
+    if (face == nullptr)
+    {
+        return nullptr;
+    }
+
+    LiteFont* font = create_font(face, size);
+    if (g_glyph_sdf)
+    {
+        attach_sdf(font);
+    }
+    else
+    {
+        open_glyph_cache(font);
+    }
+    g_memory.fonts++;
+
+    /* rasterize ascii ahead, in the background when it can */
+    for (uint32_t codepoint = 0; codepoint < 128; codepoint++)
+    {
+        font->ascii_advance[codepoint] = get_glyph(font, codepoint)->xadvance;
+    }
+    font->tab_width   = font->ascii_advance['\t'];
+    font->ascii_epoch = glyph_epoch();
+
+    /* rasterized in place when glyphs aren't async, save the cache now */
+    LiteFont* rasterized = font->sdf ? font->sdf : font;
+    if (rasterized->cache_miss && rasterized->pending_count == 0)
+    {
+        save_glyph_cache(rasterized);
+    }
+
+    /* code fonts measure printable ascii by length alone */
+    font->fixed_advance = font->ascii_advance[' '];
+    for (uint32_t codepoint = ' '; codepoint <= '~'; codepoint++)
+    {
+        if (font->ascii_advance[codepoint] != font->fixed_advance)
+        {
+            font->fixed_advance = 0;
+            break;
+        }
+    }
+
+    return font;
+}
+
+
+void lite_free_font(LiteFont* font)
+{
+    LiteFontFace* face = font->face;
+    destroy_font(font);
+
+    g_memory.fonts--;
+    release_face(face);
+}
+
+
+void lite_set_font_tab_width(LiteFont* font, int32_t n)
+{
+    font->tab_width           = n;
+    font->ascii_advance['\t'] = n;
+}
+
+
+int32_t lite_get_font_tab_width(LiteFont* font)
+{
+    return font->tab_width;
+}
+
+
+/* ascii is measured without looking glyphs up, so keep all of it cached and
+** its pages from being evicted while text is measured this frame; draws may
+** run on workers and must find the glyphs measured for them */
+static void touch_ascii_glyphs(LiteFont* font)
+{
+    uint32_t epoch = glyph_epoch();
+    if (font->ascii_epoch != epoch)
+    {
+        for (uint32_t codepoint = 0; codepoint < 128; codepoint++)
+        {
+            get_glyph(font, codepoint);
+        }
+        font->ascii_epoch = epoch;
+    }
+}
+
+
+int32_t lite_get_font_width(LiteFont* font, LiteStringView text)
+{
+    int32_t			x = 0;
+    LiteStringView	p = text;
+    uint32_t		codepoint;
+    touch_ascii_glyphs(font);
+    while (p.length > 0)
+    {
+        /* most tokens are too short to pay for a kernel call */
+        size_t run = p.length < 16 ? text_run_scalar(p.buffer, p.length) : g_text_run(p.buffer, p.length);
+        if (font->fixed_advance)
+        {
+            x += (int32_t)run * font->fixed_advance;
+        }
+        else
+        {
+            for (size_t i = 0; i < run; i++)
+            {
+                x += font->ascii_advance[(uint8_t)p.buffer[i]];
+            }
+        }
+        p.buffer += run;
+        p.length -= run;
+
+        if (p.length == 0)
+        {
+            break;
+        }
+        else if ((uint8_t)*p.buffer < 0x80)
+        {
+            x += font->ascii_advance[(uint8_t)*p.buffer];
+            p.buffer += 1;
+            p.length -= 1;
+        }
+        else
+        {
+            p = utf8_to_codepoint(p, &codepoint);
+            x += get_glyph(font, codepoint)->xadvance;
+        }
+    }
+    return x;
+}
+
+
+/* advance of the character text starts with, moving text past it; tabs
+** take the font's tab width from the ascii table */
+static inline int32_t take_advance(LiteFont* font, LiteStringView* text)
+{
+    uint8_t c = (uint8_t)*text->buffer;
+    if (c < 0x80)
+    {
+        text->buffer += 1;
+        text->length -= 1;
+        return font->ascii_advance[c];
+    }
+
+    uint32_t codepoint;
+    *text = utf8_to_codepoint(*text, &codepoint);
+    return get_glyph(font, codepoint)->xadvance;
+}
+
+
+void lite_get_font_advances(LiteFont* font, LiteStringView text, int32_t* xs)
+{
+    int32_t			x = 0;
+    LiteStringView	p = text;
+    touch_ascii_glyphs(font);
+    while (p.length > 0)
+    {
+        const char* start = p.buffer;
+        int32_t     width = take_advance(font, &p);
+
+        /* bytes inside a character take the x of its first byte */
+        for (const char* c = start; c < p.buffer; c++)
+        {
+            xs[c - text.buffer] = x;
+        }
+        x += width;
+    }
+    xs[text.length] = x;
+}
+
+
+size_t lite_get_font_offset_at(LiteFont* font, LiteStringView text, int32_t x)
+{
+    int32_t			pen = 0;
+    LiteStringView	p   = text;
+    touch_ascii_glyphs(font);
+    while (p.length > 0)
+    {
+        /* code fonts find the column in a printable run by dividing */
+        uint8_t c = (uint8_t)*p.buffer;
+        if (font->fixed_advance && c >= 0x20 && c < 0x7f)
+        {
+            int32_t advance = font->fixed_advance;
+            size_t  run     = g_text_run(p.buffer, p.length);
+            size_t  n       = x > pen ? (size_t)(x - pen) / (size_t)advance : 0;
+            if (n < run)
+            {
+                pen += (int32_t)n * advance;
+                return (size_t)(p.buffer - text.buffer) + n + ((x - pen) * 2 >= advance);
+            }
+
+            pen      += (int32_t)run * advance;
+            p.buffer += run;
+            p.length -= run;
+            continue;
+        }
+
+        /* the closer edge of the character under x */
+        LiteStringView next  = p;
+        int32_t        width = take_advance(font, &next);
+        if (x - pen < width)
+        {
+            return (size_t)(((x - pen) * 2 >= width ? next.buffer : p.buffer) - text.buffer);
+        }
+
+        pen += width;
+        p    = next;
+    }
+    return text.length;
+}
+
+
+int32_t lite_get_font_x_at(LiteFont* font, LiteStringView text, size_t offset)
+{
+    /* the view may not be nul-terminated, the end is never looked at */
+    if (offset >= text.length)
+    {
+        return lite_get_font_width(font, text);
+    }
+
+    /* an offset inside a valid utf-8 sequence goes back to its first byte,
+    ** undecodable bytes are characters of their own */
+    size_t start = offset;
+    while (start > 0 && offset - start < 3 && ((uint8_t)text.buffer[start] & 0xc0) == 0x80)
+    {
+        start--;
+    }
+    if (start < offset && ((uint8_t)text.buffer[start] & 0xc0) != 0x80)
+    {
+        uint32_t       codepoint;
+        LiteStringView next = utf8_to_codepoint(lite_string_view(text.buffer + start, text.length - start), &codepoint);
+        offset              = next.buffer > text.buffer + offset ? start : offset;
+    }
+
+    return lite_get_font_width(font, lite_string_view(text.buffer, offset));
+}
+
+
+void lite_set_glyph_budget(size_t bytes)
+{
+    g_glyph_budget = bytes;
+}
+
+
+size_t lite_get_glyph_budget(void)
+{
+    return g_glyph_budget;
+}
+
+
+void lite_set_glyph_sdf(bool enable)
+{
+    g_glyph_sdf = enable;
+}
+
+
+bool lite_get_glyph_sdf(void)
+{
+    return g_glyph_sdf;
+}
+
+
+void lite_set_glyph_async(bool enable)
+{
+    g_glyph_async = enable;
+
+    /* finish what is queued, so no glyph stays pending; staged glyphs are
+    ** rasterized in place when they are installed */
+    if (!enable && g_rasterizer.thread)
+    {
+        lite_mutex_lock(g_rasterizer.mutex);
+        while (g_rasterizer.queue_head != g_rasterizer.queue_count || g_rasterizer.busy)
+        {
+            lite_condition_wait(g_rasterizer.idle, g_rasterizer.mutex);
+        }
+        lite_mutex_unlock(g_rasterizer.mutex);
+    }
+    lite_poll_glyphs();
+}
+
+
+bool lite_poll_glyphs(void)
+{
+    /* the frame drawn with the lock is done by now or soon, end_frame waits
+    ** for it right after */
+    if (g_staged_fonts)
+    {
+        lite_renderer_lock_surface();
+        install_staged_glyphs();
+        lite_renderer_unlock_surface();
+    }
+
+    if (g_rasterizer.thread == nullptr)
+    {
+        return false;
+    }
+
+    lite_mutex_lock(g_rasterizer.mutex);
+    int32_t count = g_rasterizer.done_count;
+    lite_mutex_unlock(g_rasterizer.mutex);
+    if (count == 0)
+    {
+        return false;
+    }
+
+    /* installs wait for a frame being drawn, only the rasterizer adds jobs */
+    lite_renderer_lock_surface();
+    lite_mutex_lock(g_rasterizer.mutex);
+    count = g_rasterizer.done_count;
+    for (int32_t i = 0; i < count; i++)
+    {
+        install_glyph(&g_rasterizer.done[i]);
+        free(g_rasterizer.done[i].coverage);
+    }
+    g_rasterizer.done_count = 0;
+    lite_mutex_unlock(g_rasterizer.mutex);
+    lite_renderer_unlock_surface();
+
+    return count > 0;
+}
+
+
+bool lite_is_text_pending(LiteFont* font, LiteStringView text)
+{
+    /* sdf fonts wait on their reference glyphs */
+    font = font->sdf ? font->sdf : font;
+    if (font->pending_count == 0 && font->staged_count == 0)
+    {
+        return false;
+    }
+
+    LiteStringView p = text;
+    uint32_t       codepoint;
+    while (p.length > 0)
+    {
+        p                = utf8_to_codepoint(p, &codepoint);
+        LiteGlyph* glyph = find_glyph(font, codepoint);
+        if (glyph == nullptr)
+        {
+            glyph = find_staged_glyph(font, codepoint);
+        }
+        if (glyph && glyph->pending)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool lite_is_font_fixed_pitch(LiteFont* font)
+{
+    return font->fixed_advance != 0;
+}
+
+
+int32_t lite_get_font_height(LiteFont* font)
+{
+    return font->height;
+}
+
+
+LiteRect lite_get_font_ink(LiteFont* font)
+{
+    return (LiteRect){
+        .x      = font->ink_left,
+        .y      = font->ink_top,
+        .width  = font->ink_right - font->ink_left,
+        .height = font->ink_bottom - font->ink_top,
+    };
+}
+
+
+LiteStringView lite_get_font_filename(LiteFont* font)
+{
+    return font->face->filename;
+}
+
+
+float lite_get_font_size(LiteFont* font)
+{
+    return font->size;
+}
+
+
+static inline LiteColor blend_pixel(LiteColor dst, LiteColor src)
+{
+    int32_t ia = 0xff - src.a;
+    dst.r      = ((src.r * src.a) + (dst.r * ia)) >> 8;
+    dst.g      = ((src.g * src.a) + (dst.g * ia)) >> 8;
+    dst.b      = ((src.b * src.a) + (dst.b * ia)) >> 8;
+    return dst;
+}
+
+
+/* blend_pixel2 of a white pixel with alpha `coverage`, the glyph blit */
+static inline LiteColor blend_coverage(LiteColor dst, uint8_t coverage, LiteColor color)
+{
+    uint8_t a  = (coverage * color.a) >> 8;
+    uint8_t ia = 0xff - a;
+    dst.r      = ((0xff * color.r * a) >> 16) + ((dst.r * ia) >> 8);
+    dst.g      = ((0xff * color.g * a) >> 16) + ((dst.g * ia) >> 8);
+    dst.b      = ((0xff * color.b * a) >> 16) + ((dst.b * ia) >> 8);
+    return dst;
+}
+
+
+static inline LiteColor blend_pixel2(LiteColor dst, LiteColor src, LiteColor color)
+{
+    src.a      = (src.a * color.a) >> 8;
+    uint8_t ia = 0xff - src.a;
+    dst.r      = ((src.r * color.r * src.a) >> 16) + ((dst.r * ia) >> 8);
+    dst.g      = ((src.g * color.g * src.a) >> 16) + ((dst.g * ia) >> 8);
+    dst.b      = ((src.b * color.b * src.a) >> 16) + ((dst.b * ia) >> 8);
+    return dst;
+}
+
+
+/* row kernels of lite_draw_rect: fill with an opaque color, or blend a
+** translucent one exactly like blend_pixel; the SIMD versions compute
+** (src * a + dst * (255 - a)) >> 8 in 16-bit lanes, keeping dst alpha */
+typedef void LitePixelRowFunc(LiteColor* dst, int32_t count, LiteColor color);
+
+static void fill_row_scalar(LiteColor* dst, int32_t count, LiteColor color)
+{
+    for (int32_t i = 0; i < count; i++)
+    {
+        dst[i] = color;
+    }
+}
+
+
+static void blend_row_scalar(LiteColor* dst, int32_t count, LiteColor color)
+{
+    for (int32_t i = 0; i < count; i++)
+    {
+        dst[i] = blend_pixel(dst[i], color);
+    }
+}
 
-void lite_draw_image(LiteImage* image, LiteRect* sub, int32_t x, int32_t y, LiteColor color)
+
+#if LITE_PIXEL_X86
+LITE_TARGET("sse2")
+static void fill_row_sse2(LiteColor* dst, int32_t count, LiteColor color)
+{
+    uint32_t bits;
+    memcpy(&bits, &color, sizeof(bits));
+    __m128i c = _mm_set1_epi32((int32_t)bits);
+
+    int32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128((__m128i*)(dst + i), c);
+    }
+    fill_row_scalar(dst + i, count - i, color);
+}
+
+
+LITE_TARGET("sse2")
+static void blend_row_sse2(LiteColor* dst, int32_t count, LiteColor color)
+{
+    /* two pixels per 8 lanes in b, g, r, a order; the alpha lane adds
+    ** nothing and scales by 256 so dst alpha comes out unchanged */
+    int16_t ia   = (int16_t)(0xff - color.a);
+    int16_t b    = (int16_t)(color.b * color.a);
+    int16_t g    = (int16_t)(color.g * color.a);
+    int16_t r    = (int16_t)(color.r * color.a);
+    __m128i src  = _mm_setr_epi16(b, g, r, 0, b, g, r, 0);
+    __m128i mul  = _mm_setr_epi16(ia, ia, ia, 256, ia, ia, ia, 256);
+    __m128i zero = _mm_setzero_si128();
+
+    int32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i d  = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = _mm_unpacklo_epi8(d, zero);
+        __m128i hi = _mm_unpackhi_epi8(d, zero);
+        lo         = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, mul), src), 8);
+        hi         = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, mul), src), 8);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    blend_row_scalar(dst + i, count - i, color);
+}
+
+
+LITE_TARGET("avx2")
+static void fill_row_avx2(LiteColor* dst, int32_t count, LiteColor color)
+{
+    uint32_t bits;
+    memcpy(&bits, &color, sizeof(bits));
+    __m256i c = _mm256_set1_epi32((int32_t)bits);
+
+    int32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_si256((__m256i*)(dst + i), c);
+    }
+
+    /* finish inline, calling non-vex code with dirty ymm registers stalls */
+    for (; i < count; i++)
+    {
+        dst[i] = color;
+    }
+}
+
+
+LITE_TARGET("avx2")
+static void blend_row_avx2(LiteColor* dst, int32_t count, LiteColor color)
+{
+    int16_t ia   = (int16_t)(0xff - color.a);
+    int16_t b    = (int16_t)(color.b * color.a);
+    int16_t g    = (int16_t)(color.g * color.a);
+    int16_t r    = (int16_t)(color.r * color.a);
+    __m256i src  = _mm256_setr_epi16(b, g, r, 0, b, g, r, 0, b, g, r, 0, b, g, r, 0);
+    __m256i mul  = _mm256_setr_epi16(ia, ia, ia, 256, ia, ia, ia, 256,
+                                     ia, ia, ia, 256, ia, ia, ia, 256);
+    __m256i zero = _mm256_setzero_si256();
+
+    /* unpack and pack both work within 128-bit lanes, so pixels keep order */
+    int32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i d  = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo = _mm256_unpacklo_epi8(d, zero);
+        __m256i hi = _mm256_unpackhi_epi8(d, zero);
+        lo         = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(lo, mul), src), 8);
+        hi         = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(hi, mul), src), 8);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    for (; i < count; i++)
+    {
+        dst[i] = blend_pixel(dst[i], color);
+    }
+}
+
+
+static bool cpu_has_sse2(void)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    unsigned eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & (1 << 26)) != 0;
+#endif
+}
+
+
+static bool cpu_has_avx2(void)
+{
+    /* the cpu must support avx2 and the os must save the ymm registers */
+    unsigned eax, ebx, ecx, edx;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    ecx = (unsigned)info[2];
+#else
+    if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+#endif
+
+    if ((ecx & (1 << 27)) == 0 || (ecx & (1 << 28)) == 0)
+    {
+        return false;
+    }
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    uint64_t xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    ebx = (unsigned)info[1];
+#else
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    uint64_t xcr0 = ((uint64_t)xcr0_hi << 32) | xcr0_lo;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+#endif
+
+    return (xcr0 & 6) == 6 && (ebx & (1 << 5)) != 0;
+}
+#endif
+
+
+#if LITE_PIXEL_NEON
+static void fill_row_neon(LiteColor* dst, int32_t count, LiteColor color)
+{
+    uint32_t bits;
+    memcpy(&bits, &color, sizeof(bits));
+    uint32x4_t c = vdupq_n_u32(bits);
+
+    int32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_u32((uint32_t*)(dst + i), c);
+    }
+    fill_row_scalar(dst + i, count - i, color);
+}
+
+
+static void blend_row_neon(LiteColor* dst, int32_t count, LiteColor color)
+{
+    /* dst * ia + src * a for all bytes, then the alpha bytes are put back */
+    uint16_t   b        = (uint16_t)(color.b * color.a);
+    uint16_t   g        = (uint16_t)(color.g * color.a);
+    uint16_t   r        = (uint16_t)(color.r * color.a);
+    uint16_t   lanes[8] = {b, g, r, 0, b, g, r, 0};
+    uint16x8_t src      = vld1q_u16(lanes);
+    uint8x8_t  ia       = vdup_n_u8((uint8_t)(0xff - color.a));
+    uint8x16_t alpha    = vreinterpretq_u8_u32(vdupq_n_u32(0xff000000u));
+
+    int32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint8x16_t d  = vld1q_u8((const uint8_t*)(dst + i));
+        uint16x8_t lo = vmlal_u8(src, vget_low_u8(d), ia);
+        uint16x8_t hi = vmlal_u8(src, vget_high_u8(d), ia);
+        uint8x16_t o  = vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+        vst1q_u8((uint8_t*)(dst + i), vbslq_u8(alpha, d, o));
+    }
+    blend_row_scalar(dst + i, count - i, color);
+}
+#endif
+
+
+/* glyph row kernels tint and blend a row of coverage exactly like
+** blend_coverage; every step fits 16-bit lanes: the coverage scaled by the
+** color alpha is (n * a) >> 8, the tint is mulhi(255 * c, a) and the
+** background (d * (255 - a)) >> 8, the alpha lane scales dst by 256 */
+typedef void LiteGlyphRowFunc(LiteColor* dst, const uint8_t* coverage, int32_t count, LiteColor color);
+
+static void glyph_row_scalar(LiteColor* dst, const uint8_t* coverage, int32_t count, LiteColor color)
+{
+    for (int32_t i = 0; i < count; i++)
+    {
+        dst[i] = blend_coverage(dst[i], coverage[i], color);
+    }
+}
+
+
+#if LITE_PIXEL_X86
+/* four pixels, shared with the avx2 kernel which inlines it VEX-encoded */
+LITE_TARGET("sse2")
+static inline __m128i glyph_blend4_sse2(__m128i d, const uint8_t* coverage,
+                                        __m128i tint, __m128i keep, __m128i base, __m128i alpha)
+{
+    /* four coverages to four scaled alphas, each spread over a pixel */
+    int32_t n4;
+    memcpy(&n4, coverage, sizeof(n4));
+    __m128i zero = _mm_setzero_si128();
+    __m128i a    = _mm_unpacklo_epi8(_mm_cvtsi32_si128(n4), zero);
+    a            = _mm_srli_epi16(_mm_mullo_epi16(a, alpha), 8);
+    a            = _mm_unpacklo_epi16(a, a);
+    __m128i a01  = _mm_unpacklo_epi32(a, a);
+    __m128i a23  = _mm_unpackhi_epi32(a, a);
+
+    __m128i lo   = _mm_unpacklo_epi8(d, zero);
+    __m128i hi   = _mm_unpackhi_epi8(d, zero);
+    lo = _mm_add_epi16(_mm_mulhi_epu16(tint, a01),
+                       _mm_srli_epi16(_mm_mullo_epi16(lo, _mm_sub_epi16(base, _mm_and_si128(a01, keep))), 8));
+    hi = _mm_add_epi16(_mm_mulhi_epu16(tint, a23),
+                       _mm_srli_epi16(_mm_mullo_epi16(hi, _mm_sub_epi16(base, _mm_and_si128(a23, keep))), 8));
+    return _mm_packus_epi16(lo, hi);
+}
+
+
+LITE_TARGET("sse2")
+static void glyph_row_sse2(LiteColor* dst, const uint8_t* coverage, int32_t count, LiteColor color)
+{
+    int16_t b     = (int16_t)(0xff * color.b);
+    int16_t g     = (int16_t)(0xff * color.g);
+    int16_t r     = (int16_t)(0xff * color.r);
+    __m128i tint  = _mm_setr_epi16(b, g, r, 0, b, g, r, 0);
+    __m128i keep  = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    __m128i base  = _mm_setr_epi16(0xff, 0xff, 0xff, 256, 0xff, 0xff, 0xff, 256);
+    __m128i alpha = _mm_set1_epi16(color.a);
+
+    int32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        d         = glyph_blend4_sse2(d, coverage + i, tint, keep, base, alpha);
+        _mm_storeu_si128((__m128i*)(dst + i), d);
+    }
+    glyph_row_scalar(dst + i, coverage + i, count - i, color);
+}
+
+
+LITE_TARGET("avx2")
+static void glyph_row_avx2(LiteColor* dst, const uint8_t* coverage, int32_t count, LiteColor color)
+{
+    int16_t b     = (int16_t)(0xff * color.b);
+    int16_t g     = (int16_t)(0xff * color.g);
+    int16_t r     = (int16_t)(0xff * color.r);
+    __m256i tint  = _mm256_setr_epi16(b, g, r, 0, b, g, r, 0, b, g, r, 0, b, g, r, 0);
+    __m256i keep  = _mm256_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0);
+    __m256i base  = _mm256_setr_epi16(0xff, 0xff, 0xff, 256, 0xff, 0xff, 0xff, 256,
+                                      0xff, 0xff, 0xff, 256, 0xff, 0xff, 0xff, 256);
+    __m128i alpha = _mm_set1_epi16(color.a);
+    __m256i zero  = _mm256_setzero_si256();
+
+    int32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        /* unpacking dst works per 128-bit lane: lo holds pixels 0, 1, 4, 5
+        ** and hi 2, 3, 6, 7, so the spread alphas are laid out the same */
+        __m128i a   = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(coverage + i)));
+        a           = _mm_srli_epi16(_mm_mullo_epi16(a, alpha), 8);
+        __m128i a03 = _mm_unpacklo_epi16(a, a);
+        __m128i a47 = _mm_unpackhi_epi16(a, a);
+        __m256i alo = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi32(a03, a03)),
+                                              _mm_unpacklo_epi32(a47, a47), 1);
+        __m256i ahi = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpackhi_epi32(a03, a03)),
+                                              _mm_unpackhi_epi32(a47, a47), 1);
+
+        __m256i d   = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo  = _mm256_unpacklo_epi8(d, zero);
+        __m256i hi  = _mm256_unpackhi_epi8(d, zero);
+        lo = _mm256_add_epi16(_mm256_mulhi_epu16(tint, alo),
+                              _mm256_srli_epi16(_mm256_mullo_epi16(lo, _mm256_sub_epi16(base, _mm256_and_si256(alo, keep))), 8));
+        hi = _mm256_add_epi16(_mm256_mulhi_epu16(tint, ahi),
+                              _mm256_srli_epi16(_mm256_mullo_epi16(hi, _mm256_sub_epi16(base, _mm256_and_si256(ahi, keep))), 8));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    /* glyph rows are often shorter than 8 pixels, take 4 at a time too */
+    if (i + 4 <= count)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        d         = glyph_blend4_sse2(d, coverage + i, _mm256_castsi256_si128(tint),
+                                      _mm256_castsi256_si128(keep), _mm256_castsi256_si128(base), alpha);
+        _mm_storeu_si128((__m128i*)(dst + i), d);
+        i += 4;
+    }
+
+    for (; i < count; i++)
+    {
+        dst[i] = blend_coverage(dst[i], coverage[i], color);
+    }
+}
+#endif
+
+
+#if LITE_PIXEL_NEON
+static inline uint8x8_t glyph_channel_neon(uint8x8_t d, uint16x8_t a, uint8x8_t ia, uint16x4_t tint)
+{
+    uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(a), tint), 16);
+    uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(a), tint), 16);
+    return vadd_u8(vmovn_u16(vcombine_u16(lo, hi)), vshrn_n_u16(vmull_u8(d, ia), 8));
+}
+
+
+static void glyph_row_neon(LiteColor* dst, const uint8_t* coverage, int32_t count, LiteColor color)
+{
+    /* pixels are loaded split into channel planes, alpha is left alone */
+    uint8x8_t  ca = vdup_n_u8(color.a);
+    uint16x4_t tb = vdup_n_u16((uint16_t)(0xff * color.b));
+    uint16x4_t tg = vdup_n_u16((uint16_t)(0xff * color.g));
+    uint16x4_t tr = vdup_n_u16((uint16_t)(0xff * color.r));
+
+    int32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t d  = vld4_u8((const uint8_t*)(dst + i));
+        uint8x8_t   a  = vshrn_n_u16(vmull_u8(vld1_u8(coverage + i), ca), 8);
+        uint8x8_t   ia = vmvn_u8(a);
+        uint16x8_t  aw = vmovl_u8(a);
+        d.val[0]       = glyph_channel_neon(d.val[0], aw, ia, tb);
+        d.val[1]       = glyph_channel_neon(d.val[1], aw, ia, tg);
+        d.val[2]       = glyph_channel_neon(d.val[2], aw, ia, tr);
+        vst4_u8((uint8_t*)(dst + i), d);
+    }
+    glyph_row_scalar(dst + i, coverage + i, count - i, color);
+}
+#endif
+
+
+static LitePixelKernels  g_pixel_kernels = LitePixelKernels_Scalar;
+static LitePixelRowFunc* g_fill_row      = fill_row_scalar;
+static LitePixelRowFunc* g_blend_row     = blend_row_scalar;
+static LiteGlyphRowFunc* g_glyph_row     = glyph_row_scalar;
+
+
+bool lite_renderer_set_pixel_kernels(LitePixelKernels kernels)
+{
+    LitePixelRowFunc* fill  = nullptr;
+    LitePixelRowFunc* blend = nullptr;
+    LiteGlyphRowFunc* glyph = nullptr;
+    LiteTextRunFunc*  text  = nullptr;
+    switch (kernels)
+    {
+    case LitePixelKernels_Scalar:
+        fill  = fill_row_scalar;
+        blend = blend_row_scalar;
+        glyph = glyph_row_scalar;
+        text  = text_run_scalar;
+        break;
+
+#if LITE_PIXEL_X86
+    case LitePixelKernels_SSE2:
+        if (cpu_has_sse2())
+        {
+            fill  = fill_row_sse2;
+            blend = blend_row_sse2;
+            glyph = glyph_row_sse2;
+            text  = text_run_sse2;
+        }
+        break;
+
+    case LitePixelKernels_AVX2:
+        if (cpu_has_avx2())
+        {
+            fill  = fill_row_avx2;
+            blend = blend_row_avx2;
+            glyph = glyph_row_avx2;
+            text  = text_run_avx2;
+        }
+        break;
+#endif
+
+#if LITE_PIXEL_NEON
+    case LitePixelKernels_NEON:
+        fill  = fill_row_neon;
+        blend = blend_row_neon;
+        glyph = glyph_row_neon;
+        text  = text_run_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    if (fill == nullptr)
+    {
+        return false;
+    }
+
+    g_pixel_kernels = kernels;
+    g_fill_row      = fill;
+    g_blend_row     = blend;
+    g_glyph_row     = glyph;
+    g_text_run      = text;
+    return true;
+}
+
+
+LitePixelKernels lite_renderer_get_pixel_kernels(void)
+{
+    return g_pixel_kernels;
+}
+
+
+static void init_pixel_kernels(void)
+{
+    for (int32_t kernels = LitePixelKernels_COUNT - 1; kernels >= 0; kernels--)
+    {
+        if (lite_renderer_set_pixel_kernels((LitePixelKernels)kernels))
+        {
+            break;
+        }
+    }
+}
+
+
+void lite_draw_rect(LiteRect rect, LiteColor color)
 {
     if (color.a == 0)
     {
         return;
     }
 
-    /* clip */
+    LiteImage* target = g_context.target;
+
+    int32_t x1 = rect.x < g_context.clip.left ? g_context.clip.left : rect.x;
+    int32_t y1 = rect.y < g_context.clip.top ? g_context.clip.top : rect.y;
+    int32_t x2 = rect.x + rect.width;
+    int32_t y2 = rect.y + rect.height;
+    x2         = x2 > g_context.clip.right ? g_context.clip.right : x2;
+    y2         = y2 > g_context.clip.bottom ? g_context.clip.bottom : y2;
+
+    if (x2 <= x1 || y2 <= y1)
+    {
+        return;
+    }
+
+    g_context.stats.pixels += (int64_t)(x2 - x1) * (y2 - y1);
+
+    /* carets and borders are too narrow to pay for the vector setup */
+    LiteColor*        d    = target->pixels + x1 + y1 * target->width;
+    LitePixelRowFunc* row  = color.a == 0xff ? g_fill_row : g_blend_row;
+    if (x2 - x1 < 8)
+    {
+        row = color.a == 0xff ? fill_row_scalar : blend_row_scalar;
+    }
+    for (int32_t j = y1; j < y2; j++)
+    {
+        row(d, x2 - x1, color);
+        d += target->width;
+    }
+}
+
+
+/* clip a blit of `sub` at x, y to the clip rect, false if nothing is left */
+static bool clip_blit(LiteRect* sub, int32_t* x, int32_t* y)
+{
     int32_t n;
-    if ((n = clip.left - x) > 0)
+    if ((n = g_context.clip.left - *x) > 0)
     {
         sub->width -= n;
         sub->x += n;
-        x += n;
+        *x += n;
     }
-    if ((n = clip.top - y) > 0)
+    if ((n = g_context.clip.top - *y) > 0)
     {
         sub->height -= n;
         sub->y += n;
-        y += n;
+        *y += n;
     }
-    if ((n = x + sub->width - clip.right) > 0)
+    if ((n = *x + sub->width - g_context.clip.right) > 0)
     {
         sub->width -= n;
     }
-    if ((n = y + sub->height - clip.bottom) > 0)
+    if ((n = *y + sub->height - g_context.clip.bottom) > 0)
     {
         sub->height -= n;
     }
 
     if (sub->width <= 0 || sub->height <= 0)
+    {
+        return false;
+    }
+
+    g_context.stats.pixels += (int64_t)sub->width * sub->height;
+    return true;
+}
+
+
+void lite_draw_image(LiteImage* image, LiteRect* sub, int32_t x, int32_t y, LiteColor color)
+{
+    if (color.a == 0)
     {
         return;
     }
 
-    // @note(maihd): trick, need to handle resize event instead
-    g_surface.pixels  = (LiteColor*)lite_window_surface(
-        &g_surface.width, &g_surface.height
-    );
+    LiteImage* target = g_context.target;
+
+    /* clip */
+    if (!clip_blit(sub, &x, &y))
+    {
+        return;
+    }
 
     /* draw */
     LiteColor*    s    = image->pixels;
-    LiteColor*    d    = g_surface.pixels;
+    LiteColor*    d    = target->pixels;
     s += sub->x + sub->y * image->width;
-    d += x + y * g_surface.width;
+    d += x + y * target->width;
     int32_t sr = image->width - sub->width;
-    int32_t dr = g_surface.width - sub->width;
+    int32_t dr = target->width - sub->width;
 
     for (int32_t j = 0; j < sub->height; j++)
     {
@@ -500,24 +2959,249 @@ void lite_draw_image(LiteImage* image, LiteRect* sub, int32_t x, int32_t y, Lite
 }
 
 
-int32_t lite_draw_text(LiteFont* font, LiteStringView text, int32_t x, int32_t y, LiteColor color)
+static bool draw_glyph(const LiteFont* font, const LiteGlyph* glyph, int32_t x, int32_t y, LiteColor color)
+{
+    LiteRect sub = { glyph->x, glyph->y, glyph->width, glyph->height };
+    if (color.a == 0 || !clip_blit(&sub, &x, &y))
+    {
+        return false;
+    }
+
+    LiteImage*     target = g_context.target;
+    int32_t        stride = font->page_size;
+    const uint8_t* s      = font->pages[glyph->page].coverage + sub.x + sub.y * stride;
+    LiteColor*     d      = target->pixels + x + y * target->width;
+    for (int32_t j = 0; j < sub.height; j++)
+    {
+        g_glyph_row(d, s, sub.width, color);
+        s += stride;
+        d += target->width;
+    }
+    return true;
+}
+
+
+/* clamp a sample position to a distance field of size texels, the padding
+** keeps its border outside the outline */
+static inline void sdf_sample(float u, int32_t size, int32_t* index, uint32_t* weight)
+{
+    float last = (float)(size - 1);
+    u          = u < 0.0f ? 0.0f : u > last ? last : u;
+
+    int32_t i = (int32_t)u;
+    i         = i > size - 2 ? size - 2 : i;
+    *index    = i;
+    *weight   = (uint32_t)((u - (float)i) * 256.0f + 0.5f);
+}
+
+
+/* scale a reference glyph to the font size, bilinear distances go through
+** the font's ramp into coverage rows for the glyph kernel */
+static bool draw_sdf_glyph(const LiteFont* font, const LiteGlyph* ref, int32_t x, int32_t y, LiteColor color)
+{
+    const LiteFont* sdf   = font->sdf;
+    float           scale = font->scale / sdf->scale;
+    float           left  = (float)x + (float)ref->xoff * scale;
+    float           top   = (float)y + (float)font->ascent + (float)(ref->yoff - sdf->ascent) * scale;
+
+    int32_t x1 = (int32_t)floorf(left);
+    int32_t y1 = (int32_t)floorf(top);
+    int32_t x2 = (int32_t)ceilf(left + (float)ref->width * scale);
+    int32_t y2 = (int32_t)ceilf(top + (float)ref->height * scale);
+    x1         = x1 < g_context.clip.left ? g_context.clip.left : x1;
+    y1         = y1 < g_context.clip.top ? g_context.clip.top : y1;
+    x2         = x2 > g_context.clip.right ? g_context.clip.right : x2;
+    y2         = y2 > g_context.clip.bottom ? g_context.clip.bottom : y2;
+    if (color.a == 0 || x2 <= x1 || y2 <= y1)
+    {
+        return false;
+    }
+
+    g_context.stats.pixels += (int64_t)(x2 - x1) * (y2 - y1);
+
+    LiteImage*     target = g_context.target;
+    int32_t        stride = sdf->page_size;
+    const uint8_t* field  = sdf->pages[ref->page].coverage + ref->x + ref->y * stride;
+    float          step   = 1.0f / scale;
+
+    int32_t  columns[SDF_SPAN];
+    uint32_t weights[SDF_SPAN];
+    uint8_t  coverage[SDF_SPAN];
+    for (int32_t cx = x1; cx < x2; cx += SDF_SPAN)
+    {
+        int32_t count = x2 - cx < SDF_SPAN ? x2 - cx : SDF_SPAN;
+        for (int32_t i = 0; i < count; i++)
+        {
+            sdf_sample(((float)(cx + i) + 0.5f - left) * step - 0.5f, ref->width, &columns[i], &weights[i]);
+        }
+
+        for (int32_t py = y1; py < y2; py++)
+        {
+            int32_t  row;
+            uint32_t wy;
+            sdf_sample(((float)py + 0.5f - top) * step - 0.5f, ref->height, &row, &wy);
+
+            const uint8_t* r0 = field + row * stride;
+            const uint8_t* r1 = r0 + stride;
+            for (int32_t i = 0; i < count; i++)
+            {
+                int32_t  c  = columns[i];
+                uint32_t wx = weights[i];
+                uint32_t a  = r0[c] * (256 - wx) + r0[c + 1] * wx;
+                uint32_t b  = r1[c] * (256 - wx) + r1[c + 1] * wx;
+                coverage[i] = font->sdf_ramp[(a * (256 - wy) + b * wy + (1u << 15)) >> 16];
+            }
+
+            /* the padding is empty, blit only what the outline covers */
+            int32_t first = 0, last = count;
+            while (first < last && coverage[first] == 0)
+            {
+                first++;
+            }
+            while (last > first && coverage[last - 1] == 0)
+            {
+                last--;
+            }
+            if (first < last)
+            {
+                g_glyph_row(target->pixels + cx + first + py * target->width, coverage + first, last - first, color);
+            }
+        }
+    }
+    return true;
+}
+
+
+/* text is measured on the recording thread before it is drawn, so drawing
+** finds its glyphs without touching the cache; only direct callers of
+** lite_draw_text miss, and they load the glyph when they are the recording
+** thread outside lite_renderer_draw_regions. Workers and the render thread
+** hold the surface lock loading takes, a glyph they miss is skipped */
+static const LiteGlyph* find_draw_glyph(const LiteFont* font, uint32_t codepoint)
+{
+    const LiteGlyph* glyph = find_glyph(font, codepoint);
+    if (glyph == nullptr && g_recording_thread && g_draw_lock_depth == 0)
+    {
+        glyph = get_glyph((LiteFont*)font, codepoint);
+    }
+    return glyph;
+}
+
+
+/* move the pen over the characters of text that start left of limit,
+** returns how many bytes it moved over */
+static size_t advance_text(const LiteFont* font, LiteStringView text, int32_t tab_width, int32_t* x, int32_t limit)
+{
+    LiteStringView	p   = text;
+    int32_t			pen = *x;
+    uint32_t		codepoint;
+    while (p.length > 0 && pen < limit)
+    {
+        uint8_t c = (uint8_t)*p.buffer;
+        if (font->fixed_advance && c >= 0x20 && c < 0x7f)
+        {
+            /* printable ascii of code fonts moves the pen by a multiple, a
+            ** minified line then costs the same wherever it is scrolled */
+            int64_t n   = ((int64_t)limit - pen - 1) / font->fixed_advance + 1;
+            size_t  run = g_text_run(p.buffer, (size_t)n < p.length ? (size_t)n : p.length);
+            pen        += (int32_t)run * font->fixed_advance;
+            p.buffer   += run;
+            p.length   -= run;
+        }
+        else if (c < 0x80)
+        {
+            pen      += c == '\t' ? tab_width : font->ascii_advance[c];
+            p.buffer += 1;
+            p.length -= 1;
+        }
+        else
+        {
+            p = utf8_to_codepoint(p, &codepoint);
+
+            const LiteGlyph* g = find_draw_glyph(font, codepoint);
+            pen               += g ? g->xadvance : 0;
+        }
+    }
+
+    *x = pen;
+    return (size_t)(p.buffer - text.buffer);
+}
+
+
+LiteStringView lite_clip_text(LiteFont* font, LiteStringView text, int32_t tab_width, int32_t* x, int32_t left, int32_t right)
+{
+    /* glyphs whose ink ends left of the clip, then those starting before its right */
+    size_t skipped = advance_text(font, text, tab_width, x, left - font->ink_right + 1);
+    text.buffer   += skipped;
+    text.length   -= skipped;
+
+    int32_t pen = *x;
+    return lite_string_view(text.buffer, advance_text(font, text, tab_width, &pen, right - font->ink_left));
+}
+
+
+static inline int32_t draw_codepoint(const LiteFont* font, uint32_t codepoint, int32_t tab_width,
+                                     int32_t x, int32_t y, LiteColor color)
+{
+    /* tab advance is passed in rather than read from the shared font */
+    if (codepoint == '\t')
+    {
+        return x + tab_width;
+    }
+
+    const LiteGlyph* g = find_draw_glyph(font, codepoint);
+    if (g == nullptr)
+    {
+        return x + (codepoint < 0x80 ? font->ascii_advance[codepoint] : 0);
+    }
+
+    if (font->sdf)
+    {
+        const LiteGlyph* ref = find_glyph(font->sdf, codepoint);
+        if (ref && ref->page >= 0)
+        {
+            g_context.stats.glyphs += draw_sdf_glyph(font, ref, x, y, color);
+        }
+    }
+    else if (g->page >= 0)
+    {
+        g_context.stats.glyphs += draw_glyph(font, g, x + g->xoff, y + g->yoff, color);
+    }
+    return x + g->xadvance;
+}
+
+
+int32_t lite_draw_text(LiteFont* font, LiteStringView text, int32_t tab_width, int32_t x, int32_t y, LiteColor color)
 {
-    LiteRect		rect;
-    LiteStringView	p = text; 
+    /* lines outside the clip only move the pen */
+    if (color.a == 0 || y + font->ink_bottom <= g_context.clip.top || y + font->ink_top >= g_context.clip.bottom)
+    {
+        advance_text(font, text, tab_width, &x, INT32_MAX);
+        return x;
+    }
+
+    LiteStringView	p = lite_clip_text(font, text, tab_width, &x, g_context.clip.left, g_context.clip.right);
+    LiteStringView	rest = lite_string_view(p.buffer + p.length, text.length - (size_t)(p.buffer - text.buffer) - p.length);
     uint32_t		codepoint;
     while (p.length > 0)
     {
-        p                    = utf8_to_codepoint(p, &codepoint);
-        LiteGlyphSet*    set = get_glyphset(font, codepoint);
-        stbtt_bakedchar* g   = &set->glyphs[codepoint & 0xff];
-        rect.x               = g->x0;
-        rect.y               = g->y0;
-        rect.width           = g->x1 - g->x0;
-        rect.height          = g->y1 - g->y0;
-        lite_draw_image(set->image, &rect, x + (int32_t)g->xoff, y + (int32_t)g->yoff, color);
+        /* ascii runs skip decoding, code rarely has anything else */
+        size_t run = g_text_run(p.buffer, p.length);
+        for (size_t i = 0; i < run; i++)
+        {
+            x = draw_codepoint(font, (uint8_t)p.buffer[i], tab_width, x, y, color);
+        }
+        p.buffer += run;
+        p.length -= run;
 
-        x += (int32_t)g->xadvance;
+        if (p.length > 0)
+        {
+            p = utf8_to_codepoint(p, &codepoint);
+            x = draw_codepoint(font, codepoint, tab_width, x, y, color);
+        }
     }
+
+    advance_text(font, rest, tab_width, &x, INT32_MAX);
     return x;
 }
 
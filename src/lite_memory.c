@@ -1,8 +1,50 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS
+#endif
+
 #include "lite_memory.h"
 #include <assert.h>
 
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// @note(maihd): virtual memory is reserved up front and committed on demand,
+//     posix systems (used by the headless tools) map it inaccessible first
+static void* memory_reserve(size_t size)
+{
+#if defined(_WIN32)
+    return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE);
+#else
+    void* memory = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory != MAP_FAILED ? memory : nullptr;
+#endif
+}
+
+static void* memory_commit(void* memory, size_t size)
+{
+#if defined(_WIN32)
+    return VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE);
+#else
+    return mprotect(memory, size, PROT_READ | PROT_WRITE) == 0 ? memory : nullptr;
+#endif
+}
+
+static void memory_release(void* memory, size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif
+}
 
 LiteArena* lite_arena_create_default(void)
 {
@@ -13,10 +55,10 @@ LiteArena* lite_arena_create_default(void)
 
 LiteArena* lite_arena_create(size_t commit, size_t reserved, size_t alignment)
 {
-    void* memory = VirtualAlloc(nullptr, reserved, MEM_RESERVE, PAGE_READWRITE);
+    void* memory = memory_reserve(reserved);
     assert(memory);
 
-    memory = VirtualAlloc(memory, commit, MEM_COMMIT, PAGE_READWRITE);
+    memory = memory_commit(memory, commit);
     assert(memory);
 
     LiteArena* arena = (LiteArena*)memory;
@@ -53,7 +95,7 @@ void lite_arena_destroy(LiteArena* arena)
     while (current != nullptr)
     {
         LiteArena* prev = current->prev;
-        VirtualFree(current, 0, MEM_FREE);
+        memory_release(current, current->capacity);
         current = prev;
     }
 }
@@ -88,8 +130,7 @@ uint8_t* lite_arena_acquire(LiteArena* arena, size_t size)
             ((aligned_size - remain_size) / current->commit + 1) *
             current->commit;
         void* commited_block =
-            VirtualAlloc((uint8_t*)current + current->committed, commit_size,
-                         MEM_COMMIT, PAGE_READWRITE);
+            memory_commit((uint8_t*)current + current->committed, commit_size);
         assert(commited_block);
         (void)commited_block;
         current->committed += commit_size;
@@ -136,4 +177,72 @@ void lite_frame_arena_end(void)
     g_frame_arena_temp = (LiteArenaTemp){0};
 }
 
+
+const uint8_t* lite_map_file(const char* path, size_t* size)
+{
+    *size = 0;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    LARGE_INTEGER file_size;
+    HANDLE        mapping = nullptr;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+    if (mapping == nullptr)
+    {
+        return nullptr;
+    }
+
+    // @note(maihd): the view keeps the mapping alive until it is unmapped
+    const uint8_t* data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data)
+    {
+        *size = (size_t)file_size.QuadPart;
+    }
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    void*       data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    *size = (size_t)st.st_size;
+    return (const uint8_t*)data;
+#endif
+}
+
+
+void lite_unmap_file(const uint8_t* data, size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void*)data, size);
+#endif
+}
+
 //! EOF
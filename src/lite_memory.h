@@ -50,6 +50,10 @@ LiteArena*  lite_frame_arena_get(void);
 void        lite_frame_arena_begin(void);
 void        lite_frame_arena_end(void);
 
+/// Map a whole file read-only, nullptr when it can't be opened or is empty
+const uint8_t* lite_map_file(const char* path, size_t* size);
+void        lite_unmap_file(const uint8_t* data, size_t size);
+
 
 // ----------------------------------------------------------------------------
 // Implementation
@@ -81,12 +81,12 @@
 
 /// __forceinline attribute
 /// @note(maihd): polyfill for multiple compiler to make sure will inline even
-/// on optimize off (unsure)
+/// on optimize off (unsure), static so header definitions don't clash at link
 #if !defined(_MSC_VER) && !defined(__forceinline)
 #   if defined(__GNUC__)
-#       define __forceinline __attribute__((always_inline))
+#       define __forceinline static inline __attribute__((always_inline))
 #   else
-#       define __forceinline inline
+#       define __forceinline static inline
 #   endif
 #endif
 
@@ -1,5 +1,9 @@
 #include "lite_rencache.h"
+#include "lite_rencache_ffi.h"
+#include "lite_rencache_trace.h"
 #include "lite_memory.h"
+#include "lite_thread.h"
+#include "lite_window.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,49 +14,224 @@
 ** of hash values, take the cells that have changed since the previous frame,
 ** merge them into dirty rectangles and redraw only those regions */
 
-#define CELLS_X   80
-#define CELLS_Y   50
-#define CELL_SIZE 96
+/* while hashing, every drawable command is also binned into the cells it
+** touches, so redrawing a dirty rectangle only visits the commands found in
+** the bins of its cells instead of walking the whole command list */
+
+/* end_frame can hand the recorded commands to a render thread and return,
+** so Lua records the next frame while the last one is hashed, rasterized and
+** presented; one frame is drawn at a time, the main thread waits for it only
+** to reuse its buffers, free fonts, resize or change settings */
+
+/* the grid covers the screen and is reallocated whenever the screen size or
+** the cell size changes; the default cell size follows the display dpi */
+#define DEFAULT_CELL_SIZE 64
+#define MIN_CELL_SIZE     16
+#define MAX_CELL_SIZE     256
+
+/* dirty cells are merged into rects as long as a merge redraws no more than
+** this many clean cells, trading redrawn pixels against presented rects */
+#define DEFAULT_MERGE_THRESHOLD 2
 
 enum
 {
     FREE_FONT,
     SET_CLIP,
     DRAW_TEXT,
-    DRAW_RECT
+    DRAW_RECT,
+    DRAW_TOKENS
 };
 
+/* commands are packed back to back in one growable buffer and walked by
+** offset; each starts with an op word holding its type in the low 8 bits and
+** its size in bytes (a multiple of COMMAND_ALIGN) above them, and only
+** carries the payload its type needs */
+#define COMMAND_ALIGN 8
+
 typedef struct Command Command;
 
-struct alignas(16) Command
+/* common prefix of SET_CLIP and the draw commands */
+struct Command
 {
-    Command*    next;
-
-    int32_t     size;
-    int32_t     type;
+    uint32_t    op;
     LiteRect    rect;
+};
+
+typedef struct RectCommand
+{
+    Command     base;
+    LiteColor   color;
+} RectCommand;
+
+typedef struct TextCommand
+{
+    Command     base;
     LiteColor   color;
-    LiteFont*   font;
     int32_t     tab_width;
-    char        text[0];
-};
+    uint32_t    length;
+    LiteFont*   font;
+    char        text[];
+} TextCommand;
 
-static uint32_t  cells_buf1[CELLS_X * CELLS_Y];
-static uint32_t  cells_buf2[CELLS_X * CELLS_Y];
-static uint32_t* cells_prev = cells_buf1;
-static uint32_t* cells      = cells_buf2;
+/* a line of tokens drawn one after another in their own colors, adjacent
+** tokens of one color share a run; the text of all runs follows them */
+typedef struct TokenRun
+{
+    uint32_t    length;
+    LiteColor   color;
+} TokenRun;
 
-static LiteRect rect_buf[CELLS_X * CELLS_Y / 2];
+typedef struct TokensCommand
+{
+    Command     base;
+    LiteColor   color;      /* of the first run, where texts keep theirs */
+    int32_t     tab_width;
+    uint32_t    length;
+    LiteFont*   font;
+    uint32_t    run_count;
+    TokenRun    runs[];
+} TokensCommand;
 
-static LiteArena*    command_buf;
-static LiteArenaTemp command_buf_temp;
+typedef struct FontCommand
+{
+    uint32_t    op;
+    LiteFont*   font;
+} FontCommand;
+
+static int32_t   cell_size;
+static int32_t   cells_x;
+static int32_t   cells_y;
+static bool      cells_resize;
+static uint64_t* cells_prev;
+static uint64_t* cells;
+
+static LiteRect* rect_buf;
+static int32_t*  rect_dirty;
+static int32_t   merge_threshold = DEFAULT_MERGE_THRESHOLD;
+
+/* a frame's commands and its text with glyphs still rasterizing, which
+** gets its cells redrawn once lite_poll_glyphs installs them; the main thread
+** records into one while the render thread draws the other */
+typedef struct Frame
+{
+    uint8_t*    commands;
+    size_t      size;
+    size_t      capacity;
+    int32_t     count;
+
+    LiteRect*   pending_text;
+    int32_t     pending_count;
+    int32_t     pending_capacity;
+
+    bool        glyphs_ready;   /* glyphs were installed before it was drawn */
+    bool        invalidate;     /* the surface can't be trusted anymore */
+    bool        free_fonts;     /* has FREE_FONT commands */
+} Frame;
+
+static Frame         frames[2];
+static Frame*        frame = &frames[0];
+
+static LiteArena*    frame_buf;
+static LiteArenaTemp frame_buf_temp;
+
+static LiteThread*        render_thread;
+static LiteMutex*         render_mutex;
+static LiteCondition*     render_wake;
+static LiteCondition*     render_done;
+static Frame*             render_job;       /* being drawn, null when idle */
+static bool               render_quit;
+static bool               render_async;
+static bool               render_presented; /* the first present shows the window */
+
+/* clip rects and rects written by LuaJIT through the ffi, pushed as commands
+** ahead of anything else drawn after them */
+#define FFI_BATCH_CAPACITY 4096
+
+static LiteRencacheFfi ffi_batch;
+
+typedef struct DrawItem
+{
+    Command*    command;
+    uint64_t    key;        /* command_key() of the command */
+    LiteRect    clip;       /* clip rect active when the command was issued */
+    LiteRect    bounds;     /* visible part of the command (rect & clip) */
+} DrawItem;
 
-static Command* first_command;
-static Command* last_command;
+static int32_t* bin_starts;
 
 static LiteRect screen_rect;
+static LiteRect clip_rect;      /* last set this frame, text is trimmed to it */
 static bool     show_debug;
 
+static bool      pending_glyphs;
+
+
+/* the hud graphs the time between the last frames, the part of it spent in
+** end_frame in a lighter shade; it is drawn over the surface after the cache,
+** so the cells under it are redrawn every frame while it is shown */
+#define HUD_SAMPLES   120
+#define HUD_BAR_WIDTH 2
+#define HUD_HEIGHT    64
+#define HUD_MARGIN    8
+#define HUD_MAX_MS    (1000.0f / 30)
+
+static bool              show_hud;
+static float             hud_frame_ms[HUD_SAMPLES];
+static float             hud_cache_ms[HUD_SAMPLES];
+static int32_t           hud_sample;
+static uint64_t          hud_last_ticks;
+
+static LiteRencacheStats stats;
+static LiteRencacheStats drawn_stats;   /* of the last frame drawn, under render_mutex */
+
+
+/* while tracing, every frame's commands are appended to the trace file with
+** fonts replaced by ids; a font gets its id (its slot in trace_fonts) and a
+** record the first time a frame uses it */
+static FILE*      trace_file;
+static LiteFont** trace_fonts;
+static int32_t    trace_font_count;
+static int32_t    trace_font_capacity;
+
+
+/* scroll detection -- a clip region that shows the same commands as last
+** frame shifted vertically gets its pixels moved on the surface, and only the
+** strip scrolled into view is left for the dirty cells to redraw */
+
+#define SCROLL_MIN_AREA    (128 * 128)
+#define SCROLL_MAX_REGIONS 32
+#define SCROLL_MAX_TRIES   8
+
+typedef struct ScrollEntry
+{
+    uint64_t    key;        /* command content, without its vertical position */
+    int32_t     y;          /* rect.y of the command */
+    int32_t     top;        /* visible rows of the command */
+    int32_t     bottom;
+    bool        fixed;      /* covers the whole region, scrolling can't move it */
+} ScrollEntry;
+
+typedef struct ScrollRegion
+{
+    LiteRect    clip;
+    int32_t     first;
+    int32_t     count;      /* -1 when the region can't be scrolled */
+} ScrollRegion;
+
+typedef struct ScrollState
+{
+    ScrollRegion    regions[SCROLL_MAX_REGIONS];
+    int32_t         region_count;
+    ScrollEntry*    entries;
+    int32_t         entry_count;
+    int32_t         entry_capacity;
+} ScrollState;
+
+static ScrollState  scroll_buf1;
+static ScrollState  scroll_buf2;
+static ScrollState* scroll_prev = &scroll_buf1;
+static ScrollState* scroll      = &scroll_buf2;
+
 #ifdef _WIN32
 #undef min
 #undef max
@@ -71,23 +250,59 @@ static inline int32_t max(int32_t a, int32_t b)
 }
 
 
-/* 32bit fnv-1a hash */
-#define HASH_INITIAL 2166136261
+/* 64bit multiply-rotate hash, eight bytes per step; only the semantic fields
+** of a command are hashed, never padding or the list pointer */
+#define HASH_INITIAL 0xcbf29ce484222325ull
+
+
+static inline uint64_t hash_word(uint64_t h, uint64_t v)
+{
+    return ((h << 5 | h >> 59) ^ v) * 0x517cc1b727220a95ull;
+}
+
+
+static inline uint64_t hash_finish(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
 
 
-static void hash(uint32_t* h, const void* data, size_t size)
+static uint64_t hash_bytes(uint64_t h, const void* data, size_t size)
 {
     const uint8_t* p = data;
-    while (size--)
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        h = hash_word(h, v);
+    }
+
+    if (size > 0)
     {
-        *h = (*h ^ *p++) * 16777619;
+        uint64_t v = 0;
+        memcpy(&v, p, size);
+        h = hash_word(h, v);
     }
+
+    return h;
 }
 
 
 static inline int32_t cell_idx(int32_t x, int32_t y)
 {
-    return x + y * CELLS_X;
+    return x + y * cells_x;
+}
+
+
+static inline bool rects_intersect(LiteRect a, LiteRect b)
+{
+    return b.x + b.width > a.x && b.x < a.x + a.width &&
+           b.y + b.height > a.y && b.y < a.y + a.height;
 }
 
 
@@ -121,311 +336,1954 @@ static LiteRect merge_rects(LiteRect a, LiteRect b)
 }
 
 
-static Command* push_command(int32_t type, size_t size)
+static inline uint32_t command_type(const void* cmd)
 {
-    Command* cmd = (Command*)lite_arena_acquire(command_buf, size);
-    memset(cmd, 0, sizeof(Command));
-    cmd->type = type;
-    cmd->size = size;
-    cmd->next = nullptr;
+    return *(const uint32_t*)cmd & 0xff;
+}
 
-    if (first_command == nullptr)
-    {
-        first_command       = cmd;
-        last_command        = cmd;
-    }
-    else
+
+static inline uint32_t command_size(const void* cmd)
+{
+    return *(const uint32_t*)cmd >> 8;
+}
+
+
+/* the returned command is only valid until the next push */
+static void* push_command(int32_t type, size_t size)
+{
+    size = (size + COMMAND_ALIGN - 1) & ~(size_t)(COMMAND_ALIGN - 1);
+    if (frame->size + size > frame->capacity)
     {
-        last_command->next  = cmd;
-        last_command        = cmd;
+        size_t capacity = frame->capacity ? frame->capacity : 64 * 1024;
+        while (capacity < frame->size + size)
+        {
+            capacity *= 2;
+        }
+
+        uint8_t* buf = realloc(frame->commands, capacity);
+        if (buf == nullptr)
+        {
+            return nullptr;
+        }
+
+        frame->commands = buf;
+        frame->capacity = capacity;
     }
 
+    uint32_t* cmd = (uint32_t*)(frame->commands + frame->size);
+    *cmd          = (uint32_t)type | (uint32_t)size << 8;
+    frame->size  += size;
+    frame->count++;
     return cmd;
 }
 
 
-static bool next_command(Command** prev)
+/* the last command pushed gives back the bytes it didn't use */
+static void shrink_last_command(void* cmd, size_t size)
+{
+    size = (size + COMMAND_ALIGN - 1) & ~(size_t)(COMMAND_ALIGN - 1);
+    frame->size      -= command_size(cmd) - size;
+    *(uint32_t*)cmd   = command_type(cmd) | (uint32_t)size << 8;
+}
+
+
+static inline const char* tokens_text(const TokensCommand* cmd)
+{
+    return (const char*)(cmd->runs + cmd->run_count);
+}
+
+
+static bool next_command(const Frame* f, Command** prev)
+{
+    uint8_t* p   = *prev == nullptr ? f->commands : (uint8_t*)*prev + command_size(*prev);
+    *prev        = (Command*)p;
+    return p < f->commands + f->size;
+}
+
+
+static void* check_alloc(void* ptr)
 {
-    if (*prev == nullptr)
+    if (!ptr)
     {
-        *prev = first_command;
+        fprintf(stderr, "Fatal error: memory allocation failed\n");
+        exit(-1);
     }
-    else
+
+    return ptr;
+}
+
+
+static void free_cells(void)
+{
+    free(cells);
+    free(cells_prev);
+    free(rect_buf);
+    free(rect_dirty);
+    free(bin_starts);
+    cells      = nullptr;
+    cells_prev = nullptr;
+    rect_buf   = nullptr;
+    rect_dirty = nullptr;
+    bin_starts = nullptr;
+    cells_x    = 0;
+    cells_y    = 0;
+}
+
+
+static void resize_cells(void)
+{
+    free_cells();
+
+    /* one extra column and row: a rect ending on the screen edge still
+    ** touches the cell past it */
+    cells_x = screen_rect.width / cell_size + 1;
+    cells_y = screen_rect.height / cell_size + 1;
+
+    size_t count = (size_t)cells_x * cells_y;
+    cells        = check_alloc(malloc(count * sizeof(uint64_t)));
+    cells_prev   = check_alloc(malloc(count * sizeof(uint64_t)));
+    rect_buf     = check_alloc(malloc(count * sizeof(LiteRect)));
+    rect_dirty   = check_alloc(malloc(count * sizeof(int32_t)));
+    bin_starts   = check_alloc(malloc((count + 1) * sizeof(int32_t)));
+
+    for (size_t i = 0; i < count; i++)
     {
-        *prev = (*prev)->next;
+        cells[i] = HASH_INITIAL;
     }
+    cells_resize = false;
+}
 
-    return *prev != nullptr;
+
+static int32_t ffi_draw_text(LiteFont* font, const char* text, size_t length, int32_t x, int32_t y, uint32_t color)
+{
+    LiteColor c = { .r = (uint8_t)(color >> 24), .g = (uint8_t)(color >> 16), .b = (uint8_t)(color >> 8), .a = (uint8_t)color };
+    return lite_rencache_draw_text(font, lite_string_view(text, length), x, y, c);
 }
 
 
-void lite_rencache_init(void)
+static void render_frame(Frame* f);
+
+
+static int32_t render_main(void* userdata)
 {
-    if (command_buf == nullptr)
+    (void)userdata;
+
+    lite_mutex_lock(render_mutex);
+    for (;;)
     {
-        command_buf =
-            lite_arena_create(512 * 1024, 10 * 1024 * 1024, alignof(Command));
+        while (!render_quit && render_job == nullptr)
+        {
+            lite_condition_wait(render_wake, render_mutex);
+        }
+
+        if (render_quit)
+        {
+            break;
+        }
+
+        Frame* job = render_job;
+        lite_mutex_unlock(render_mutex);
+
+        render_frame(job);
+
+        lite_mutex_lock(render_mutex);
+        drawn_stats = stats;
+        render_job  = nullptr;
+        lite_condition_broadcast(render_done);
     }
+    lite_mutex_unlock(render_mutex);
+
+    return 0;
 }
 
 
-void lite_rencache_deinit(void)
+/* the frame being drawn owns the render side, cells, scroll state and surface */
+static void wait_render(void)
 {
-    lite_arena_destroy(command_buf);
-    command_buf = nullptr;
+    if (render_thread == nullptr)
+    {
+        return;
+    }
+
+    lite_mutex_lock(render_mutex);
+    while (render_job)
+    {
+        lite_condition_wait(render_done, render_mutex);
+    }
+    lite_mutex_unlock(render_mutex);
 }
 
 
-void lite_rencache_show_debug(bool enable)
+/* the thread is only around while frames are drawn asynchronously, tools
+** and synchronous setups never pay for it */
+static void start_render_thread(void)
 {
-    show_debug = enable;
+    render_mutex  = lite_mutex_create();
+    render_wake   = lite_condition_create();
+    render_done   = lite_condition_create();
+    render_quit   = false;
+    render_thread = lite_thread_create(render_main, "lite-frames", nullptr);
 }
 
 
-void lite_rencache_free_font(LiteFont* font)
+static void stop_render_thread(void)
 {
-    Command* cmd = push_command(FREE_FONT, sizeof(Command));
-    if (cmd)
+    if (render_thread)
+    {
+        wait_render();
+        lite_mutex_lock(render_mutex);
+        render_quit = true;
+        lite_condition_broadcast(render_wake);
+        lite_mutex_unlock(render_mutex);
+        lite_thread_join(render_thread);
+        render_thread = nullptr;
+    }
+
+    /* frames are drawn in place from now on, their stats are read directly */
+    if (render_mutex)
     {
-        cmd->font = font;
+        lite_condition_destroy(render_done);
+        lite_condition_destroy(render_wake);
+        lite_mutex_destroy(render_mutex);
+        render_mutex = nullptr;
+        render_wake  = nullptr;
+        render_done  = nullptr;
     }
 }
 
 
-void lite_rencache_set_clip_rect(LiteRect rect)
+void lite_rencache_init(void)
 {
-    Command* cmd = push_command(SET_CLIP, sizeof(Command));
-    if (cmd)
+    if (frame_buf == nullptr)
+    {
+        frame_buf =
+            lite_arena_create(512 * 1024, 10 * 1024 * 1024, alignof(DrawItem));
+    }
+
+    if (ffi_batch.commands == nullptr)
     {
-        cmd->rect = intersect_rects(rect, screen_rect);
+        ffi_batch.commands  = check_alloc(malloc(FFI_BATCH_CAPACITY * sizeof(LiteRencacheFfiCommand)));
+        ffi_batch.capacity  = FFI_BATCH_CAPACITY;
+        ffi_batch.flush     = lite_rencache_flush_ffi;
+        ffi_batch.draw_text = ffi_draw_text;
     }
+
+    /* asynchronous drawing asked for before a deinit carries over */
+    if (render_async && render_mutex == nullptr)
+    {
+        start_render_thread();
+    }
+
+    /* scale with dpi, so a cell covers about the same text at any scale */
+    float dpi = lite_window_dpi();
+    lite_rencache_set_cell_size((int32_t)(DEFAULT_CELL_SIZE * dpi / 96.0f + 0.5f));
 }
 
 
-void lite_rencache_draw_rect(LiteRect rect, LiteColor color)
+void lite_rencache_deinit(void)
 {
-    if (!rects_overlap(screen_rect, rect))
+    lite_rencache_stop_trace();
+
+    stop_render_thread();
+    render_presented = false;
+
+    lite_arena_destroy(frame_buf);
+    frame_buf = nullptr;
+
+    for (int32_t i = 0; i < 2; i++)
     {
-        return;
+        free(frames[i].commands);
+        free(frames[i].pending_text);
+        frames[i] = (Frame){0};
     }
+    frame = &frames[0];
 
-    Command* cmd = push_command(DRAW_RECT, sizeof(Command));
-    if (cmd)
+    free_cells();
+    screen_rect = (LiteRect){0};
+
+    free(scroll_buf1.entries);
+    free(scroll_buf2.entries);
+    scroll_buf1 = (ScrollState){0};
+    scroll_buf2 = (ScrollState){0};
+
+    free(ffi_batch.commands);
+    ffi_batch = (LiteRencacheFfi){0};
+}
+
+
+void lite_rencache_set_async(bool enable)
+{
+    if (enable && render_mutex == nullptr)
+    {
+        start_render_thread();
+    }
+    else if (!enable)
     {
-        cmd->rect  = rect;
-        cmd->color = color;
+        stop_render_thread();
     }
+
+    render_async = enable;
 }
 
 
-int32_t lite_rencache_draw_text(LiteFont* font, LiteStringView text, int32_t x,
-                                int32_t y, LiteColor color)
+bool lite_rencache_get_async(void)
 {
-    LiteRect rect;
-    rect.x      = x;
-    rect.y      = y;
-    rect.width  = lite_get_font_width(font, text);
-    rect.height = lite_get_font_height(font);
+    return render_async && render_thread != nullptr;
+}
+
+
+void lite_rencache_wait(void)
+{
+    wait_render();
+}
+
 
-    if (rects_overlap(screen_rect, rect))
+void lite_rencache_set_cell_size(int32_t size)
+{
+    size = max(MIN_CELL_SIZE, min(size, MAX_CELL_SIZE));
+    if (size != cell_size)
     {
-        size_t   sz  = text.length;
-        Command* cmd = push_command(DRAW_TEXT, sizeof(Command) + sz);
-        if (cmd)
-        {
-            memcpy(cmd->text, text.buffer, sz);
-            cmd->color     = color;
-            cmd->font      = font;
-            cmd->rect      = rect;
-            cmd->tab_width = lite_get_font_tab_width(font);
-        }
+        wait_render();
+        cell_size    = size;
+        cells_resize = true;
     }
+}
+
+
+int32_t lite_rencache_get_cell_size(void)
+{
+    return cell_size;
+}
 
-    return x + rect.width;
+
+void lite_rencache_set_merge_threshold(int32_t cells)
+{
+    wait_render();
+    merge_threshold = max(0, cells);
 }
 
 
-void lite_rencache_invalidate(void)
+int32_t lite_rencache_get_merge_threshold(void)
 {
-    memset(cells_prev, 0xff, sizeof(cells_buf1));
+    return merge_threshold;
 }
 
 
-void lite_rencache_begin_frame(void)
+void lite_rencache_show_debug(bool enable)
+{
+    wait_render();
+    show_debug = enable;
+}
+
+
+void lite_rencache_show_hud(bool enable)
 {
-    command_buf_temp = lite_arena_begin_temp(command_buf);
+    wait_render();
 
-    /* reset all cells if the screen width/height has changed */
-    int32_t w, h;
-    lite_renderer_get_size(&w, &h);
-    if (screen_rect.width != w || h != screen_rect.height)
+    /* the hud pixels are not in the cache, drop them with a full redraw */
+    if (show_hud && !enable)
     {
-        screen_rect.width  = w;
-        screen_rect.height = h;
         lite_rencache_invalidate();
     }
+
+    show_hud = enable;
 }
 
 
-static void update_overlapping_cells(LiteRect r, uint32_t h)
+void lite_rencache_get_stats(LiteRencacheStats* out)
 {
-    int32_t x1 = r.x / CELL_SIZE;
-    int32_t y1 = r.y / CELL_SIZE;
-    int32_t x2 = (r.x + r.width) / CELL_SIZE;
-    int32_t y2 = (r.y + r.height) / CELL_SIZE;
-
-    for (int32_t y = y1; y <= y2; y++)
+    if (render_thread)
     {
-        for (int32_t x = x1; x <= x2; x++)
-        {
-            int32_t idx = cell_idx(x, y);
-            hash(&cells[idx], &h, sizeof(h));
-        }
+        lite_mutex_lock(render_mutex);
+        *out = drawn_stats;
+        lite_mutex_unlock(render_mutex);
+    }
+    else
+    {
+        *out = stats;
     }
 }
 
 
-static void push_rect(LiteRect r, int32_t* count)
+/* a failed write closes the trace, later writes of the frame are dropped */
+static void trace_write(const void* data, size_t size)
 {
-    /* try to merge with existing rectangle */
-    for (int i = *count - 1; i >= 0; i--)
+    if (trace_file == nullptr)
     {
-        LiteRect* rp = &rect_buf[i];
-        if (rects_overlap(*rp, r))
-        {
-            *rp = merge_rects(*rp, r);
-            return;
-        }
+        return;
     }
 
-    /* couldn't merge with previous rectangle: push */
-    rect_buf[(*count)++] = r;
+    if (fwrite(data, 1, size, trace_file) != size)
+    {
+        fprintf(stderr, "rencache: failed to write trace, stop tracing\n");
+        fclose(trace_file);
+        trace_file = nullptr;
+    }
 }
 
 
-void lite_rencache_end_frame(void)
+static void trace_write_u32(uint32_t value)
 {
-    /* update cells from commands */
-    Command* cmd = nullptr;
-    LiteRect cr  = screen_rect;
-    while (next_command(&cmd))
+    trace_write(&value, sizeof(value));
+}
+
+
+static void trace_write_rect(LiteRect rect)
+{
+    trace_write_u32((uint32_t)rect.x);
+    trace_write_u32((uint32_t)rect.y);
+    trace_write_u32((uint32_t)rect.width);
+    trace_write_u32((uint32_t)rect.height);
+}
+
+
+static void trace_write_color(LiteColor color)
+{
+    uint32_t value;
+    memcpy(&value, &color, sizeof(value));
+    trace_write_u32(value);
+}
+
+
+static int32_t trace_font_id(LiteFont* font)
+{
+    int32_t free_slot = -1;
+    for (int32_t i = 0; i < trace_font_count; i++)
     {
-        if (cmd->type == SET_CLIP)
+        if (trace_fonts[i] == font)
         {
-            cr = cmd->rect;
+            return i;
         }
 
-        LiteRect r = intersect_rects(cmd->rect, cr);
-        if (r.width == 0 || r.height == 0)
+        if (trace_fonts[i] == nullptr && free_slot < 0)
         {
-            continue;
+            free_slot = i;
         }
-
-        uint32_t h = HASH_INITIAL;
-        hash(&h, cmd, cmd->size);
-        update_overlapping_cells(r, h);
     }
 
-    /* push rects for all cells changed from last frame, reset cells */
-    int32_t rect_count = 0;
-    int32_t max_x      = screen_rect.width / CELL_SIZE + 1;
-    int32_t max_y      = screen_rect.height / CELL_SIZE + 1;
-    for (int32_t y = 0; y < max_y; y++)
+    if (free_slot < 0)
     {
-        for (int32_t x = 0; x < max_x; x++)
+        if (trace_font_count == trace_font_capacity)
         {
-            /* compare previous and current cell for change */
-            int32_t idx = cell_idx(x, y);
-            if (cells[idx] != cells_prev[idx])
-            {
-                push_rect((LiteRect){x, y, 1, 1}, &rect_count);
-            }
-            cells_prev[idx] = HASH_INITIAL;
+            trace_font_capacity = max(16, trace_font_capacity * 2);
+            trace_fonts         = check_alloc(realloc(
+                trace_fonts, trace_font_capacity * sizeof(LiteFont*)));
         }
+
+        free_slot = trace_font_count++;
     }
 
-    /* expand rects from cells to pixels */
-    for (int32_t i = 0; i < rect_count; i++)
+    trace_fonts[free_slot] = font;
+
+    float          size     = lite_get_font_size(font);
+    LiteStringView filename = lite_get_font_filename(font);
+    trace_write_u32(LiteTraceRecord_Font);
+    trace_write_u32((uint32_t)free_slot);
+    trace_write(&size, sizeof(size));
+    trace_write_u32((uint32_t)filename.length);
+    trace_write(filename.buffer, filename.length);
+    return free_slot;
+}
+
+
+static void trace_frame(void)
+{
+    /* fonts go out ahead of the frame that first uses them */
+    Command* cmd = nullptr;
+    while (next_command(frame, &cmd))
     {
-        LiteRect* r = &rect_buf[i];
-        r->x *= CELL_SIZE;
-        r->y *= CELL_SIZE;
-        r->width *= CELL_SIZE;
-        r->height *= CELL_SIZE;
-        *r = intersect_rects(*r, screen_rect);
+        if (command_type(cmd) == DRAW_TEXT)
+        {
+            trace_font_id(((TextCommand*)cmd)->font);
+        }
+        else if (command_type(cmd) == DRAW_TOKENS)
+        {
+            trace_font_id(((TokensCommand*)cmd)->font);
+        }
     }
 
-    /* redraw updated regions */
-    bool has_free_commands = false;
-    for (int32_t i = 0; i < rect_count; i++)
+    trace_write_u32(LiteTraceRecord_Frame);
+    trace_write_u32((uint32_t)screen_rect.width);
+    trace_write_u32((uint32_t)screen_rect.height);
+    trace_write_u32((uint32_t)frame->count);
+
+    cmd = nullptr;
+    while (next_command(frame, &cmd) && trace_file)
     {
-        /* draw */
-        LiteRect r = rect_buf[i];
-        lite_renderer_set_clip_rect(r);
+        switch (command_type(cmd))
+        {
+        case SET_CLIP:
+            trace_write_u32(LiteTraceCommand_SetClip);
+            trace_write_rect(cmd->rect);
+            break;
+
+        case DRAW_RECT:
+            trace_write_u32(LiteTraceCommand_DrawRect);
+            trace_write_rect(cmd->rect);
+            trace_write_color(((RectCommand*)cmd)->color);
+            break;
+
+        case DRAW_TEXT:
+        {
+            TextCommand* text = (TextCommand*)cmd;
+            trace_write_u32(LiteTraceCommand_DrawText);
+            trace_write_u32((uint32_t)trace_font_id(text->font));
+            trace_write_u32((uint32_t)cmd->rect.x);
+            trace_write_u32((uint32_t)cmd->rect.y);
+            trace_write_color(text->color);
+            trace_write_u32((uint32_t)text->tab_width);
+            trace_write_u32(text->length);
+            trace_write(text->text, text->length);
+            break;
+        }
 
-        cmd = nullptr;
-        while (next_command(&cmd))
+        case DRAW_TOKENS:
         {
-            switch (cmd->type)
+            TokensCommand* tokens = (TokensCommand*)cmd;
+            trace_write_u32(LiteTraceCommand_DrawTokens);
+            trace_write_u32((uint32_t)trace_font_id(tokens->font));
+            trace_write_u32((uint32_t)cmd->rect.x);
+            trace_write_u32((uint32_t)cmd->rect.y);
+            trace_write_u32((uint32_t)tokens->tab_width);
+            trace_write_u32(tokens->run_count);
+            for (uint32_t i = 0; i < tokens->run_count; i++)
             {
-            case FREE_FONT:
-                has_free_commands = true;
-                break;
+                trace_write_u32(tokens->runs[i].length);
+                trace_write_color(tokens->runs[i].color);
+            }
+            trace_write(tokens_text(tokens), tokens->length);
+            break;
+        }
+
+        case FREE_FONT:
+        {
+            /* only fonts the trace has seen need to be released */
+            LiteFont* font = ((FontCommand*)cmd)->font;
+            for (int32_t i = 0; i < trace_font_count; i++)
+            {
+                if (trace_fonts[i] == font)
+                {
+                    trace_write_u32(LiteTraceCommand_FreeFont);
+                    trace_write_u32((uint32_t)i);
+                    trace_fonts[i] = nullptr;
+                    break;
+                }
+            }
+            break;
+        }
+        }
+    }
+}
+
+
+bool lite_rencache_start_trace(LiteStringView filename)
+{
+    lite_rencache_stop_trace();
+
+    /* the view may not be nul-terminated */
+    char path[1024];
+    if (filename.length >= sizeof(path))
+    {
+        return false;
+    }
+    memcpy(path, filename.buffer, filename.length);
+    path[filename.length] = '\0';
+
+    trace_file = fopen(path, "wb");
+    if (trace_file == nullptr)
+    {
+        return false;
+    }
+
+    trace_write_u32(LITE_TRACE_MAGIC);
+    trace_write_u32(LITE_TRACE_VERSION);
+    return trace_file != nullptr;
+}
+
+
+void lite_rencache_stop_trace(void)
+{
+    if (trace_file)
+    {
+        fclose(trace_file);
+        trace_file = nullptr;
+    }
+
+    free(trace_fonts);
+    trace_fonts         = nullptr;
+    trace_font_count    = 0;
+    trace_font_capacity = 0;
+}
+
+
+void lite_rencache_free_font(LiteFont* font)
+{
+    lite_rencache_flush_ffi();
+
+    FontCommand* cmd = push_command(FREE_FONT, sizeof(FontCommand));
+    if (cmd)
+    {
+        cmd->font         = font;
+        frame->free_fonts = true;
+    }
+}
+
+
+static void push_clip_rect(LiteRect rect)
+{
+    clip_rect    = intersect_rects(rect, screen_rect);
+    Command* cmd = push_command(SET_CLIP, sizeof(Command));
+    if (cmd)
+    {
+        cmd->rect = clip_rect;
+    }
+}
+
+
+static void push_rect(LiteRect rect, LiteColor color)
+{
+    if (!rects_overlap(screen_rect, rect))
+    {
+        return;
+    }
+
+    RectCommand* cmd = push_command(DRAW_RECT, sizeof(RectCommand));
+    if (cmd)
+    {
+        cmd->base.rect = rect;
+        cmd->color     = color;
+    }
+}
+
+
+void lite_rencache_set_clip_rect(LiteRect rect)
+{
+    lite_rencache_flush_ffi();
+    push_clip_rect(rect);
+}
+
+
+void lite_rencache_draw_rect(LiteRect rect, LiteColor color)
+{
+    lite_rencache_flush_ffi();
+    push_rect(rect, color);
+}
+
+
+LiteRencacheFfi* lite_rencache_get_ffi(void)
+{
+    return &ffi_batch;
+}
+
+
+void lite_rencache_flush_ffi(void)
+{
+    int32_t count   = ffi_batch.count < ffi_batch.capacity ? ffi_batch.count : ffi_batch.capacity;
+    ffi_batch.count = 0;
+    for (int32_t i = 0; i < count; i++)
+    {
+        const LiteRencacheFfiCommand* c    = &ffi_batch.commands[i];
+        LiteRect                      rect = { c->x, c->y, c->width, c->height };
+        if (c->type == LITE_RENCACHE_FFI_SET_CLIP)
+        {
+            push_clip_rect(rect);
+        }
+        else if (c->type == LITE_RENCACHE_FFI_DRAW_RECT)
+        {
+            LiteColor color = {
+                .r = (uint8_t)(c->color >> 24), .g = (uint8_t)(c->color >> 16), .b = (uint8_t)(c->color >> 8), .a = (uint8_t)c->color,
+            };
+            push_rect(rect, color);
+        }
+    }
+}
+
+
+/* text waiting on glyphs is redrawn where its ink can land once they are
+** installed, which reaches past the advances of italics and overhangs */
+static void push_pending_text(LiteFont* font, LiteRect rect)
+{
+    LiteRect ink = lite_get_font_ink(font);
+    rect         = (LiteRect){
+        .x      = rect.x + ink.x,
+        .y      = rect.y + ink.y,
+        .width  = rect.width + ink.width,
+        .height = ink.height,
+    };
+
+    if (frame->pending_count == frame->pending_capacity)
+    {
+        frame->pending_capacity = frame->pending_capacity ? frame->pending_capacity * 2 : 64;
+        frame->pending_text     = check_alloc(
+            realloc(frame->pending_text, frame->pending_capacity * sizeof(LiteRect)));
+    }
+    frame->pending_text[frame->pending_count++] = rect;
+}
+
+
+int32_t lite_rencache_draw_text(LiteFont* font, LiteStringView text, int32_t x,
+                                int32_t y, LiteColor color)
+{
+    lite_rencache_flush_ffi();
+
+    LiteRect rect;
+    rect.x      = x;
+    rect.y      = y;
+    rect.width  = lite_get_font_width(font, text);
+    rect.height = lite_get_font_height(font);
+
+    int32_t next_x    = x + rect.width;
+    int32_t tab_width = lite_get_font_tab_width(font);
+
+    /* long lines keep only what shows through the clip, so copying, hashing
+    ** and replaying them doesn't grow with their length */
+    if (rects_overlap(clip_rect, rect))
+    {
+        text       = lite_clip_text(font, text, tab_width, &rect.x, clip_rect.x, clip_rect.x + clip_rect.width);
+        rect.width = lite_get_font_width(font, text);
+    }
+
+    if (text.length > 0 && rects_overlap(clip_rect, rect))
+    {
+        size_t       sz  = text.length;
+        TextCommand* cmd = push_command(DRAW_TEXT, sizeof(TextCommand) + sz);
+        if (cmd)
+        {
+            memcpy(cmd->text, text.buffer, sz);
+            cmd->base.rect = rect;
+            cmd->color     = color;
+            cmd->tab_width = tab_width;
+            cmd->length    = (uint32_t)sz;
+            cmd->font      = font;
+
+            if (lite_is_text_pending(font, text))
+            {
+                push_pending_text(font, rect);
+            }
+        }
+    }
+
+    return next_x;
+}
+
+
+int32_t lite_rencache_draw_tokens(LiteFont* font, const LiteTextToken* tokens, int32_t count, int32_t x, int32_t y)
+{
+    lite_rencache_flush_ffi();
+
+    LiteRect rect;
+    rect.x      = x;
+    rect.y      = y;
+    rect.width  = 0;
+    rect.height = lite_get_font_height(font);
+
+    size_t length = 0;
+    for (int32_t i = 0; i < count; i++)
+    {
+        rect.width += lite_get_font_width(font, tokens[i].text);
+        length     += tokens[i].text.length;
+    }
+
+    int32_t next_x = x + rect.width;
+    if (!rects_overlap(clip_rect, rect))
+    {
+        return next_x;
+    }
+
+    /* room for a run per token, the text is moved down over the slots of
+    ** merged runs once it is known what shows through the clip */
+    TokensCommand* cmd = push_command(DRAW_TOKENS, sizeof(TokensCommand) + count * sizeof(TokenRun) + length);
+    if (cmd == nullptr)
+    {
+        return next_x;
+    }
+
+    int32_t   tab_width = lite_get_font_tab_width(font);
+    TokenRun* runs      = cmd->runs;
+    char*     text      = (char*)(runs + count);
+    uint32_t  run_count = 0;
+    uint32_t  used      = 0;
+    int32_t   pen       = x;
+    for (int32_t i = 0; i < count; i++)
+    {
+        LiteStringView token   = tokens[i].text;
+        int32_t        start   = pen;
+        LiteStringView visible = lite_clip_text(font, token, tab_width, &start, clip_rect.x, clip_rect.x + clip_rect.width);
+        if (visible.length == 0)
+        {
+            /* what shows is contiguous, nothing after it will */
+            if (run_count > 0 && token.length > 0)
+            {
+                break;
+            }
+            pen += lite_get_font_width(font, token);
+            continue;
+        }
+
+        int32_t width = lite_get_font_width(font, visible);
+        if (run_count == 0)
+        {
+            rect.x = start;
+        }
+        rect.width = start + width - rect.x;
+        pen        = visible.length == token.length ? start + width : pen + lite_get_font_width(font, token);
+
+        if (run_count > 0 && memcmp(&runs[run_count - 1].color, &tokens[i].color, sizeof(LiteColor)) == 0)
+        {
+            runs[run_count - 1].length += (uint32_t)visible.length;
+        }
+        else
+        {
+            runs[run_count++] = (TokenRun){ (uint32_t)visible.length, tokens[i].color };
+        }
+        memcpy(text + used, visible.buffer, visible.length);
+        used += (uint32_t)visible.length;
+
+        if (lite_is_text_pending(font, visible))
+        {
+            push_pending_text(font, (LiteRect){ start, y, width, rect.height });
+        }
+    }
+
+    if (run_count == 0)
+    {
+        /* nothing shows, drop the command */
+        frame->size -= command_size(cmd);
+        frame->count--;
+        return next_x;
+    }
+
+    memmove(runs + run_count, text, used);
+    cmd->base.rect = rect;
+    cmd->color     = runs[0].color;
+    cmd->tab_width = tab_width;
+    cmd->length    = used;
+    cmd->font      = font;
+    cmd->run_count = run_count;
+    shrink_last_command(cmd, sizeof(TokensCommand) + run_count * sizeof(TokenRun) + used);
+    return next_x;
+}
+
+
+void lite_rencache_invalidate(void)
+{
+    if (trace_file)
+    {
+        trace_write_u32(LiteTraceRecord_Invalidate);
+    }
+
+    /* applied when the frame recorded now is drawn, one may be drawing */
+    frame->invalidate = true;
+}
+
+
+bool lite_rencache_has_pending_glyphs(void)
+{
+    return pending_glyphs;
+}
+
+
+void lite_rencache_begin_frame(void)
+{
+    /* like commands pushed outside a frame, writes between frames are dropped */
+    ffi_batch.count = 0;
+
+    frame->pending_count = 0;
+
+    /* reset all cells if the screen width/height or cell size has changed */
+    int32_t w, h;
+    lite_renderer_get_size(&w, &h);
+    if (screen_rect.width != w || h != screen_rect.height || cells_resize)
+    {
+        wait_render();
+        screen_rect.width  = w;
+        screen_rect.height = h;
+        resize_cells();
+        lite_rencache_invalidate();
+    }
+    clip_rect = screen_rect;
+}
+
+
+/* hash of everything a command draws except its vertical position, so the
+** scroll detection can match commands that only moved */
+static uint64_t command_key(const Command* cmd)
+{
+    uint32_t type  = command_type(cmd);
+    uint32_t color = 0;
+    if (type != SET_CLIP)
+    {
+        /* color sits right after the prefix for both rects and texts */
+        memcpy(&color, &((const RectCommand*)cmd)->color, sizeof(color));
+    }
+
+    uint64_t h = HASH_INITIAL;
+    h = hash_word(h, type | (uint64_t)color << 32);
+    h = hash_word(h, (uint32_t)cmd->rect.x | (uint64_t)(uint32_t)cmd->rect.width << 32);
+    h = hash_word(h, (uint32_t)cmd->rect.height);
+    if (type == DRAW_TEXT)
+    {
+        const TextCommand* text = (const TextCommand*)cmd;
+        h = hash_word(h, (uint64_t)(uintptr_t)text->font);
+        h = hash_word(h, (uint32_t)text->tab_width | (uint64_t)text->length << 32);
+        h = hash_bytes(h, text->text, text->length);
+    }
+    else if (type == DRAW_TOKENS)
+    {
+        const TokensCommand* tokens = (const TokensCommand*)cmd;
+        h = hash_word(h, (uint64_t)(uintptr_t)tokens->font);
+        h = hash_word(h, (uint32_t)tokens->tab_width | (uint64_t)tokens->length << 32);
+        h = hash_bytes(h, tokens->runs, tokens->run_count * sizeof(TokenRun) + tokens->length);
+    }
+    return h;
+}
+
+
+static inline uint64_t command_hash(uint64_t key, const Command* cmd)
+{
+    return hash_finish(hash_word(key, (uint32_t)cmd->rect.y));
+}
+
+
+static void update_overlapping_cells(LiteRect r, uint64_t h)
+{
+    int32_t x1 = r.x / cell_size;
+    int32_t y1 = r.y / cell_size;
+    int32_t x2 = (r.x + r.width) / cell_size;
+    int32_t y2 = (r.y + r.height) / cell_size;
+
+    for (int32_t y = y1; y <= y2; y++)
+    {
+        for (int32_t x = x1; x <= x2; x++)
+        {
+            int32_t idx = cell_idx(x, y);
+            cells[idx]  = hash_word(cells[idx], h);
+        }
+    }
+}
+
+
+static void count_overlapping_cells(LiteRect r)
+{
+    int32_t x1 = r.x / cell_size;
+    int32_t y1 = r.y / cell_size;
+    int32_t x2 = (r.x + r.width) / cell_size;
+    int32_t y2 = (r.y + r.height) / cell_size;
+
+    for (int32_t y = y1; y <= y2; y++)
+    {
+        for (int32_t x = x1; x <= x2; x++)
+        {
+            bin_starts[cell_idx(x, y) + 1]++;
+        }
+    }
+}
+
+
+static void bin_overlapping_cells(LiteRect r, int32_t item, int32_t* bin_fill,
+                                  int32_t* bin_items)
+{
+    int32_t x1 = r.x / cell_size;
+    int32_t y1 = r.y / cell_size;
+    int32_t x2 = (r.x + r.width) / cell_size;
+    int32_t y2 = (r.y + r.height) / cell_size;
+
+    for (int32_t y = y1; y <= y2; y++)
+    {
+        for (int32_t x = x1; x <= x2; x++)
+        {
+            int32_t idx = cell_idx(x, y);
+            bin_items[bin_starts[idx] + bin_fill[idx]++] = item;
+        }
+    }
+}
+
+
+static int compare_items(const void* a, const void* b)
+{
+    return *(const int32_t*)a - *(const int32_t*)b;
+}
+
+
+/* collect the draw items binned in the cells under `r`, in command order */
+static int32_t gather_items(LiteRect r, uint32_t stamp, uint32_t* item_marks,
+                            int32_t item_count, const int32_t* bin_items,
+                            int32_t* out)
+{
+    int32_t x1 = r.x / cell_size;
+    int32_t y1 = r.y / cell_size;
+    int32_t x2 = (r.x + r.width - 1) / cell_size;
+    int32_t y2 = (r.y + r.height - 1) / cell_size;
+
+    int32_t count = 0;
+    for (int32_t y = y1; y <= y2; y++)
+    {
+        for (int32_t x = x1; x <= x2; x++)
+        {
+            int32_t idx = cell_idx(x, y);
+            for (int32_t i = bin_starts[idx]; i < bin_starts[idx + 1]; i++)
+            {
+                int32_t item = bin_items[i];
+                if (item_marks[item] != stamp)
+                {
+                    item_marks[item] = stamp;
+                    out[count++]     = item;
+                }
+            }
+        }
+    }
+
+    /* large regions touch most items: a linear scan of the marks is cheaper
+    ** than sorting them back into command order */
+    if (count > item_count / 8)
+    {
+        count = 0;
+        for (int32_t i = 0; i < item_count; i++)
+        {
+            if (item_marks[i] == stamp)
+            {
+                out[count++] = i;
+            }
+        }
+    }
+    else
+    {
+        qsort(out, count, sizeof(int32_t), compare_items);
+    }
+
+    return count;
+}
+
+
+static bool rect_is_free(LiteRect r, int32_t skip, int32_t count)
+{
+    for (int32_t i = 0; i < count; i++)
+    {
+        if (i != skip && rects_intersect(rect_buf[i], r))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* merge a run of dirty cells with the rect right above it when that wastes
+** at most merge_threshold clean cells, otherwise push it as a new rect; the
+** rects stay disjoint so they can be redrawn in parallel */
+static void push_run(LiteRect run, int32_t dirty, int32_t* count)
+{
+    int32_t  best       = -1;
+    int32_t  best_waste = merge_threshold + 1;
+    LiteRect best_rect  = run;
+    for (int32_t i = *count - 1; i >= 0; i--)
+    {
+        LiteRect r = rect_buf[i];
+        if (r.y + r.height != run.y)
+        {
+            continue;
+        }
+
+        LiteRect merged = merge_rects(r, run);
+        int32_t  waste  = merged.width * merged.height - rect_dirty[i] - dirty;
+        if (waste < best_waste && rect_is_free(merged, i, *count))
+        {
+            best       = i;
+            best_waste = waste;
+            best_rect  = merged;
+        }
+    }
+
+    if (best >= 0)
+    {
+        rect_buf[best]    = best_rect;
+        rect_dirty[best] += dirty;
+        return;
+    }
+
+    rect_buf[*count]   = run;
+    rect_dirty[*count] = dirty;
+    (*count)++;
+}
+
+
+/* coalesce the changed cells of a row into runs, bridging gaps of at most
+** merge_threshold clean cells, then merge the runs downwards */
+static void push_row(int32_t y, const bool* changed, int32_t* count)
+{
+    int32_t x = 0;
+    while (x < cells_x)
+    {
+        if (!changed[x])
+        {
+            x++;
+            continue;
+        }
+
+        int32_t x1    = x;
+        int32_t x2    = x + 1;
+        int32_t dirty = 1;
+        for (x = x2; x < cells_x; x++)
+        {
+            if (changed[x])
+            {
+                if (x - x2 > merge_threshold)
+                {
+                    break;
+                }
+
+                x2 = x + 1;
+                dirty++;
+            }
+        }
+        x = x2;
+
+        push_run((LiteRect){x1, y, x2 - x1, 1}, dirty, count);
+    }
+}
+
+
+static inline bool rect_contains(LiteRect a, LiteRect b)
+{
+    return b.x >= a.x && b.y >= a.y && b.x + b.width <= a.x + a.width &&
+           b.y + b.height <= a.y + a.height;
+}
+
+
+/* walk the items back to front keeping, per cell, the largest part of a later
+** opaque rect that covers it; an item whose visible part is covered in every
+** cell it touches can't show through and is dropped (its bounds emptied) */
+static void cull_occluded_items(DrawItem* items, int32_t item_count)
+{
+    LiteRect* occluders = (LiteRect*)lite_arena_acquire(
+        frame_buf, (size_t)cells_x * cells_y * sizeof(LiteRect));
+    memset(occluders, 0, (size_t)cells_x * cells_y * sizeof(LiteRect));
+
+    bool any_occluder = false;
+    for (int32_t i = item_count - 1; i >= 0; i--)
+    {
+        DrawItem*      item = &items[i];
+        const Command* cmd  = item->command;
+        uint32_t       type = command_type(cmd);
+        if (type == SET_CLIP)
+        {
+            continue;
+        }
+
+        LiteRect r  = item->bounds;
+        int32_t  x1 = r.x / cell_size;
+        int32_t  y1 = r.y / cell_size;
+        int32_t  x2 = (r.x + r.width - 1) / cell_size;
+        int32_t  y2 = (r.y + r.height - 1) / cell_size;
+
+        if (any_occluder)
+        {
+            bool covered = true;
+            for (int32_t y = y1; y <= y2 && covered; y++)
+            {
+                for (int32_t x = x1; x <= x2 && covered; x++)
+                {
+                    LiteRect cell = {x * cell_size, y * cell_size, cell_size, cell_size};
+                    covered       = rect_contains(occluders[cell_idx(x, y)],
+                                                  intersect_rects(r, cell));
+                }
+            }
+
+            if (covered)
+            {
+                item->bounds.width  = 0;
+                item->bounds.height = 0;
+                continue;
+            }
+        }
+
+        if (type != DRAW_RECT || ((const RectCommand*)cmd)->color.a != 0xff)
+        {
+            continue;
+        }
+
+        any_occluder = true;
+        for (int32_t y = y1; y <= y2; y++)
+        {
+            for (int32_t x = x1; x <= x2; x++)
+            {
+                LiteRect  cell = {x * cell_size, y * cell_size, cell_size, cell_size};
+                LiteRect  part = intersect_rects(r, cell);
+                LiteRect* occ  = &occluders[cell_idx(x, y)];
+                if (part.width * part.height > occ->width * occ->height)
+                {
+                    *occ = part;
+                }
+            }
+        }
+    }
+}
+
+
+static void push_scroll_entry(ScrollState* state, ScrollEntry entry)
+{
+    if (state->entry_count == state->entry_capacity)
+    {
+        state->entry_capacity = max(256, state->entry_capacity * 2);
+        state->entries        = check_alloc(realloc(
+            state->entries, state->entry_capacity * sizeof(ScrollEntry)));
+    }
+
+    state->entries[state->entry_count++] = entry;
+}
+
+
+/* record the commands showing through a clip region, starting from the last
+** opaque rect that covers it; anything drawn there with another clip (except
+** rects covering the whole region) makes the region unscrollable */
+static void build_scroll_region(ScrollState* state, LiteRect clip,
+                                const DrawItem* items, int32_t item_count)
+{
+    ScrollRegion* region = &state->regions[state->region_count++];
+    region->clip         = clip;
+    region->first        = state->entry_count;
+    region->count        = -1;
+
+    for (int32_t i = 0; i < item_count; i++)
+    {
+        const DrawItem* item = &items[i];
+        if (!rects_intersect(item->bounds, clip))
+        {
+            continue;
+        }
+
+        const Command* cmd   = item->command;
+        bool           fixed = rect_contains(item->bounds, clip);
+        if (fixed && command_type(cmd) == DRAW_RECT &&
+            ((const RectCommand*)cmd)->color.a == 0xff)
+        {
+            state->entry_count = region->first;
+            region->count      = 0;
+        }
+        else if (!fixed && memcmp(&item->clip, &clip, sizeof(LiteRect)) != 0)
+        {
+            region->count = -1;
+            break;
+        }
+
+        if (region->count < 0)
+        {
+            continue;
+        }
+
+        push_scroll_entry(state, (ScrollEntry){
+            .key    = item->key,
+            .y      = cmd->rect.y,
+            .top    = item->bounds.y,
+            .bottom = item->bounds.y + item->bounds.height,
+            .fixed  = fixed,
+        });
+        region->count++;
+    }
+
+    if (region->count < 0)
+    {
+        state->entry_count = region->first;
+    }
+}
+
+
+static void build_scroll_state(const DrawItem* items, int32_t item_count)
+{
+    scroll->region_count = 0;
+    scroll->entry_count  = 0;
+    if (show_debug)
+    {
+        return;
+    }
+
+    for (int32_t i = 0; i < item_count; i++)
+    {
+        LiteRect clip = items[i].clip;
+        if (clip.width * clip.height < SCROLL_MIN_AREA)
+        {
+            continue;
+        }
+
+        bool found = false;
+        for (int32_t j = 0; j < scroll->region_count && !found; j++)
+        {
+            found = memcmp(&scroll->regions[j].clip, &clip, sizeof(LiteRect)) == 0;
+        }
+
+        if (!found)
+        {
+            build_scroll_region(scroll, clip, items, item_count);
+            if (scroll->region_count == SCROLL_MAX_REGIONS)
+            {
+                break;
+            }
+        }
+    }
+}
+
+
+static inline bool scroll_entry_visible(const ScrollEntry* e, int32_t dy,
+                                        int32_t top, int32_t bottom)
+{
+    return e->fixed || (e->top + dy < bottom && e->bottom + dy > top);
+}
+
+
+/* the commands visible in the rows kept after scrolling by dy must be the
+** previous commands moved by dy, in the same order */
+static bool verify_scroll(const ScrollRegion* cur, const ScrollRegion* prev,
+                          int32_t dy)
+{
+    int32_t top    = max(cur->clip.y, cur->clip.y + dy);
+    int32_t bottom = min(cur->clip.y + cur->clip.height,
+                         cur->clip.y + cur->clip.height + dy);
+    if (bottom <= top)
+    {
+        return false;
+    }
+
+    const ScrollEntry* a     = &scroll->entries[cur->first];
+    const ScrollEntry* b     = &scroll_prev->entries[prev->first];
+    int32_t            i     = 0;
+    int32_t            j     = 0;
+    for (;;)
+    {
+        while (i < cur->count && !scroll_entry_visible(&a[i], 0, top, bottom))
+        {
+            i++;
+        }
+
+        while (j < prev->count && !scroll_entry_visible(&b[j], dy, top, bottom))
+        {
+            j++;
+        }
+
+        if (i == cur->count || j == prev->count)
+        {
+            return i == cur->count && j == prev->count;
+        }
 
-            case SET_CLIP:
-                lite_renderer_set_clip_rect(intersect_rects(cmd->rect, r));
-                break;
+        if (a[i].key != b[j].key || a[i].fixed != b[j].fixed ||
+            (!a[i].fixed && a[i].y != b[j].y + dy))
+        {
+            return false;
+        }
 
-            case DRAW_RECT:
-                lite_draw_rect(cmd->rect, cmd->color);
-                break;
+        i++;
+        j++;
+    }
+}
 
-            case DRAW_TEXT:
-                lite_set_font_tab_width(cmd->font, cmd->tab_width);
-                lite_draw_text(
-					cmd->font, 
-					lite_string_view(cmd->text, cmd->size - sizeof(Command)),
-					cmd->rect.x, 
-					cmd->rect.y,
-                    cmd->color);
-                break;
+
+/* guess the scroll offset from the first moving commands of the region */
+static int32_t detect_scroll(const ScrollRegion* cur, const ScrollRegion* prev)
+{
+    int32_t tried[SCROLL_MAX_TRIES];
+    int32_t tries = 0;
+
+    const ScrollEntry* a = &scroll->entries[cur->first];
+    const ScrollEntry* b = &scroll_prev->entries[prev->first];
+    for (int32_t i = 0; i < cur->count && tries < SCROLL_MAX_TRIES; i++)
+    {
+        if (a[i].fixed)
+        {
+            continue;
+        }
+
+        for (int32_t j = 0; j < prev->count && tries < SCROLL_MAX_TRIES; j++)
+        {
+            int32_t dy = a[i].y - b[j].y;
+            if (b[j].fixed || a[i].key != b[j].key || dy == 0 ||
+                abs(dy) >= cur->clip.height)
+            {
+                continue;
+            }
+
+            bool seen = false;
+            for (int32_t k = 0; k < tries && !seen; k++)
+            {
+                seen = tried[k] == dy;
+            }
+
+            if (seen)
+            {
+                continue;
+            }
+
+            tried[tries++] = dy;
+            if (verify_scroll(cur, prev, dy))
+            {
+                return dy;
             }
         }
+    }
+
+    return 0;
+}
+
 
-        if (show_debug)
+static inline double ticks_to_ms(uint64_t ticks)
+{
+    return (double)ticks * 1000.0 / (double)lite_cpu_frequency();
+}
+
+
+static LiteRect hud_rect(void)
+{
+    int32_t width = HUD_SAMPLES * HUD_BAR_WIDTH;
+    return (LiteRect){
+        .x      = screen_rect.width - width - HUD_MARGIN,
+        .y      = HUD_MARGIN,
+        .width  = width,
+        .height = HUD_HEIGHT,
+    };
+}
+
+
+/* make the cells under r differ from last frame */
+static void invalidate_cells(LiteRect r)
+{
+    r = intersect_rects(r, screen_rect);
+    if (r.width == 0 || r.height == 0)
+    {
+        return;
+    }
+
+    int32_t x1 = r.x / cell_size;
+    int32_t y1 = r.y / cell_size;
+    int32_t x2 = (r.x + r.width - 1) / cell_size;
+    int32_t y2 = (r.y + r.height - 1) / cell_size;
+    for (int32_t y = y1; y <= y2; y++)
+    {
+        for (int32_t x = x1; x <= x2; x++)
         {
-            LiteColor color = {.r = rand(), .g = rand(), .b = rand(), .a = 50};
-            lite_draw_rect(r, color);
+            int32_t idx     = cell_idx(x, y);
+            cells_prev[idx] = ~cells[idx];
         }
     }
+}
+
 
-    /* update dirty rects */
-    if (rect_count > 0)
+static void draw_hud(LiteRect surface)
+{
+    LiteRect r     = hud_rect();
+    float    scale = HUD_HEIGHT / HUD_MAX_MS;
+    lite_renderer_set_clip_rect(intersect_rects(r, surface));
+    lite_draw_rect(r, (LiteColor){.r = 20, .g = 20, .b = 20, .a = 0xff});
+
+    /* oldest sample on the left */
+    for (int32_t i = 0; i < HUD_SAMPLES; i++)
     {
-        lite_renderer_update_rects(rect_buf, rect_count);
+        int32_t s     = (hud_sample + i) % HUD_SAMPLES;
+        int32_t frame = min(HUD_HEIGHT, (int32_t)(hud_frame_ms[s] * scale + 0.5f));
+        int32_t cache = min(frame, (int32_t)(hud_cache_ms[s] * scale + 0.5f));
+        int32_t x     = r.x + i * HUD_BAR_WIDTH;
+
+        LiteColor color = {.r = 80, .g = 200, .b = 80, .a = 0xff};
+        if (hud_frame_ms[s] > HUD_MAX_MS)
+        {
+            color = (LiteColor){.r = 230, .g = 70, .b = 60, .a = 0xff};
+        }
+        else if (hud_frame_ms[s] > HUD_MAX_MS / 2)
+        {
+            color = (LiteColor){.r = 230, .g = 200, .b = 60, .a = 0xff};
+        }
+
+        lite_draw_rect((LiteRect){x, r.y + r.height - frame, HUD_BAR_WIDTH, frame - cache}, color);
+        lite_draw_rect((LiteRect){x, r.y + r.height - cache, HUD_BAR_WIDTH, cache},
+                       (LiteColor){.r = 220, .g = 220, .b = 220, .a = 0xff});
+    }
+
+    /* 60 fps budget */
+    int32_t y = r.y + r.height - (int32_t)(HUD_MAX_MS / 2 * scale + 0.5f);
+    lite_draw_rect((LiteRect){r.x, y, r.width, 1},
+                   (LiteColor){.r = 255, .g = 255, .b = 255, .a = 96});
+}
+
+
+/* move the pixels of scrolled regions, mark the cells they fully refill as
+** unchanged, return the moved rects so they get presented */
+static int32_t apply_scrolls(LiteRect* moved)
+{
+    int32_t moved_count = 0;
+    for (int32_t i = 0; i < scroll->region_count; i++)
+    {
+        const ScrollRegion* cur = &scroll->regions[i];
+        if (cur->count <= 0)
+        {
+            continue;
+        }
+
+        const ScrollRegion* prev = nullptr;
+        for (int32_t j = 0; j < scroll_prev->region_count; j++)
+        {
+            const ScrollRegion* r = &scroll_prev->regions[j];
+            if (r->count > 0 && memcmp(&r->clip, &cur->clip, sizeof(LiteRect)) == 0)
+            {
+                prev = r;
+                break;
+            }
+        }
+
+        if (prev == nullptr)
+        {
+            continue;
+        }
+
+        bool overlaps = false;
+        for (int32_t j = 0; j < moved_count && !overlaps; j++)
+        {
+            overlaps = rects_intersect(moved[j], cur->clip);
+        }
+
+        /* moving the hud pixels along would smear them over the region */
+        overlaps |= show_hud && rects_intersect(hud_rect(), cur->clip);
+
+        int32_t dy = overlaps ? 0 : detect_scroll(cur, prev);
+        if (dy == 0)
+        {
+            continue;
+        }
+
+        LiteRect clip = cur->clip;
+        lite_renderer_scroll_rect(clip, dy);
+
+        LiteRect kept = clip;
+        kept.y        = max(clip.y, clip.y + dy);
+        kept.height   = min(clip.y + clip.height, clip.y + clip.height + dy) - kept.y;
+        moved[moved_count++] = kept;
+
+        /* only cells lying entirely inside the kept rows are whole again */
+        int32_t x1 = (kept.x + cell_size - 1) / cell_size;
+        int32_t y1 = (kept.y + cell_size - 1) / cell_size;
+        int32_t x2 = (kept.x + kept.width) / cell_size;
+        int32_t y2 = (kept.y + kept.height) / cell_size;
+        for (int32_t y = y1; y < y2; y++)
+        {
+            for (int32_t x = x1; x < x2; x++)
+            {
+                int32_t idx     = cell_idx(x, y);
+                cells_prev[idx] = cells[idx];
+            }
+        }
     }
 
-    /* free fonts */
-    if (has_free_commands)
+    return moved_count;
+}
+
+
+/* scratch owned by one render worker while replaying regions */
+typedef struct ReplayWorker
+{
+    uint32_t        stamp;
+    uint32_t*       item_marks;
+    int32_t*        visible;
+} ReplayWorker;
+
+
+typedef struct RegionReplay
+{
+    const DrawItem* items;
+    int32_t         item_count;
+    const int32_t*  bin_items;
+    ReplayWorker*   workers;
+} RegionReplay;
+
+
+/* runs on render workers: only reads the frame's commands and bins */
+static void draw_region(void* userdata, LiteRect r, int32_t worker_index)
+{
+    RegionReplay* replay = (RegionReplay*)userdata;
+    ReplayWorker* worker = &replay->workers[worker_index];
+
+    int32_t count = gather_items(r, ++worker->stamp, worker->item_marks,
+                                 replay->item_count, replay->bin_items,
+                                 worker->visible);
+
+    LiteRect clip = r;
+    for (int32_t i = 0; i < count; i++)
     {
-        cmd = nullptr;
-        while (next_command(&cmd))
+        const DrawItem* item      = &replay->items[worker->visible[i]];
+        LiteRect        item_clip = intersect_rects(item->clip, r);
+        if (memcmp(&item_clip, &clip, sizeof(LiteRect)) != 0)
+        {
+            clip = item_clip;
+            lite_renderer_set_clip_rect(clip);
+        }
+
+        const Command* cmd = item->command;
+        switch (command_type(cmd))
+        {
+        case DRAW_RECT:
         {
-            if (cmd->type == FREE_FONT)
+            const RectCommand* rect = (const RectCommand*)cmd;
+            lite_draw_rect(cmd->rect, rect->color);
+            break;
+        }
+
+        case DRAW_TEXT:
+        {
+            const TextCommand* text = (const TextCommand*)cmd;
+            lite_draw_text(
+                text->font,
+                lite_string_view(text->text, text->length),
+                text->tab_width,
+                cmd->rect.x,
+                cmd->rect.y,
+                text->color);
+            break;
+        }
+
+        case DRAW_TOKENS:
+        {
+            const TokensCommand* tokens = (const TokensCommand*)cmd;
+            const char*          text   = tokens_text(tokens);
+            int32_t              x      = cmd->rect.x;
+            for (uint32_t run = 0; run < tokens->run_count; run++)
             {
-                lite_free_font(cmd->font);
+                LiteStringView run_text = lite_string_view(text, tokens->runs[run].length);
+                x                       = lite_draw_text(tokens->font, run_text, tokens->tab_width, x, cmd->rect.y, tokens->runs[run].color);
+                text                   += tokens->runs[run].length;
             }
+            break;
+        }
+        }
+    }
+}
+
+
+/* runs on the render thread, or in place: reads only the frame it is given */
+static void render_frame(Frame* f)
+{
+    frame_buf_temp = lite_arena_begin_temp(frame_buf);
+
+    if (f->invalidate)
+    {
+        /* the surface can't be trusted anymore, don't move its pixels around */
+        scroll_prev->region_count = 0;
+
+        if (cells_prev != nullptr)
+        {
+            memset(cells_prev, 0xff, (size_t)cells_x * cells_y * sizeof(uint64_t));
+        }
+    }
+
+    /* per-frame scratch lives in the frame arena and is dropped with it */
+    uint64_t  start      = lite_cpu_ticks();
+    stats.command_count  = f->count;
+    stats.command_bytes  = (int32_t)f->size;
+
+    DrawItem* items      = (DrawItem*)lite_arena_acquire(
+        frame_buf, (f->count + 1) * sizeof(DrawItem));
+    int32_t   item_count = 0;
+
+    /* collect visible commands, clip changes included */
+    Command* cmd = nullptr;
+    LiteRect cr  = screen_rect;
+    while (next_command(f, &cmd))
+    {
+        uint32_t type = command_type(cmd);
+        if (type == FREE_FONT)
+        {
+            continue;
+        }
+
+        if (type == SET_CLIP)
+        {
+            cr = cmd->rect;
+        }
+
+        LiteRect r = intersect_rects(cmd->rect, cr);
+        if (r.width == 0 || r.height == 0)
+        {
+            continue;
+        }
+
+        items[item_count++] = (DrawItem){
+            .command = cmd,
+            .clip    = cr,
+            .bounds  = r,
+        };
+    }
+
+    /* drop commands hidden under later opaque rects, then update cells from
+    ** what is left and keep only the drawable commands */
+    cull_occluded_items(items, item_count);
+
+    int32_t collected = item_count;
+    item_count        = 0;
+    for (int32_t i = 0; i < collected; i++)
+    {
+        DrawItem item = items[i];
+        if (item.bounds.width == 0)
+        {
+            continue;
+        }
+
+        item.key = command_key(item.command);
+        update_overlapping_cells(item.bounds, command_hash(item.key, item.command));
+
+        if (command_type(item.command) != SET_CLIP)
+        {
+            items[item_count++] = item;
+        }
+    }
+
+    uint64_t hashed = lite_cpu_ticks();
+
+    /* move scrolled regions before looking for changed cells */
+    build_scroll_state(items, item_count);
+    LiteRect* moved       = (LiteRect*)lite_arena_acquire(
+        frame_buf, SCROLL_MAX_REGIONS * sizeof(LiteRect));
+    int32_t   moved_count = apply_scrolls(moved);
+
+    if (show_hud)
+    {
+        invalidate_cells(hud_rect());
+    }
+
+    if (f->glyphs_ready)
+    {
+        for (int32_t i = 0; i < f->pending_count; i++)
+        {
+            invalidate_cells(f->pending_text[i]);
+        }
+    }
+
+    /* count items per cell, turn the counts into bin offsets, fill the bins */
+    memset(bin_starts, 0, ((size_t)cells_x * cells_y + 1) * sizeof(int32_t));
+    for (int32_t i = 0; i < item_count; i++)
+    {
+        count_overlapping_cells(items[i].bounds);
+    }
+
+    for (int32_t i = 0; i < cells_x * cells_y; i++)
+    {
+        bin_starts[i + 1] += bin_starts[i];
+    }
+
+    int32_t  bin_size  = bin_starts[cells_x * cells_y];
+    int32_t* bin_items = (int32_t*)lite_arena_acquire(
+        frame_buf, (bin_size + 1) * sizeof(int32_t));
+    int32_t* bin_fill  = (int32_t*)lite_arena_acquire(
+        frame_buf, cells_x * cells_y * sizeof(int32_t));
+    memset(bin_fill, 0, cells_x * cells_y * sizeof(int32_t));
+    for (int32_t i = 0; i < item_count; i++)
+    {
+        bin_overlapping_cells(items[i].bounds, i, bin_fill, bin_items);
+    }
+
+    /* push rects for all cells changed from last frame, reset cells */
+    stats.dirty_cells  = 0;
+    int32_t rect_count = 0;
+    bool*   changed    = (bool*)lite_arena_acquire(frame_buf, cells_x);
+    for (int32_t y = 0; y < cells_y; y++)
+    {
+        bool any_changed = false;
+        for (int32_t x = 0; x < cells_x; x++)
+        {
+            /* compare previous and current cell for change */
+            int32_t idx = cell_idx(x, y);
+            changed[x]  = cells[idx] != cells_prev[idx];
+            any_changed |= changed[x];
+            stats.dirty_cells += changed[x];
+            cells_prev[idx] = HASH_INITIAL;
+        }
+
+        if (any_changed)
+        {
+            push_row(y, changed, &rect_count);
+        }
+    }
+
+    /* expand rects from cells to pixels */
+    for (int32_t i = 0; i < rect_count; i++)
+    {
+        LiteRect* r = &rect_buf[i];
+        r->x *= cell_size;
+        r->y *= cell_size;
+        r->width *= cell_size;
+        r->height *= cell_size;
+        *r = intersect_rects(*r, screen_rect);
+        if (r->width == 0 || r->height == 0)
+        {
+            *r = rect_buf[--rect_count];
+            i--;
+        }
+    }
+
+    /* split dirty rects into cell rows, so a single large rect still spreads
+    ** over all render workers */
+    int32_t band_count = 0;
+    for (int32_t i = 0; i < rect_count; i++)
+    {
+        band_count += (rect_buf[i].height + cell_size - 1) / cell_size;
+    }
+
+    LiteRect* bands = (LiteRect*)lite_arena_acquire(
+        frame_buf, (band_count + 1) * sizeof(LiteRect));
+    band_count = 0;
+    for (int32_t i = 0; i < rect_count; i++)
+    {
+        LiteRect r = rect_buf[i];
+        for (int32_t y = r.y; y < r.y + r.height; y += cell_size)
+        {
+            bands[band_count++] = (LiteRect){
+                .x      = r.x,
+                .y      = y,
+                .width  = r.width,
+                .height = min(cell_size, r.y + r.height - y),
+            };
+        }
+    }
+
+    /* redraw updated regions, visiting only the commands binned under them */
+    int32_t       worker_count = lite_renderer_worker_count();
+    RegionReplay  replay       = {
+        .items        = items,
+        .item_count   = item_count,
+        .bin_items    = bin_items,
+        .workers      = (ReplayWorker*)lite_arena_acquire(
+            frame_buf, worker_count * sizeof(ReplayWorker)),
+    };
+    for (int32_t i = 0; i < worker_count; i++)
+    {
+        ReplayWorker* worker = &replay.workers[i];
+        worker->stamp        = 0;
+        worker->item_marks   = (uint32_t*)lite_arena_acquire(
+            frame_buf, (item_count + 1) * sizeof(uint32_t));
+        worker->visible      = (int32_t*)lite_arena_acquire(
+            frame_buf, (item_count + 1) * sizeof(int32_t));
+        memset(worker->item_marks, 0, item_count * sizeof(uint32_t));
+    }
+
+    /* the overlays are drawn after the regions, the window must not replace
+    ** the surface in between and they are kept inside the one drawn to */
+    lite_renderer_lock_surface();
+    uint64_t raster_start = lite_cpu_ticks();
+    lite_renderer_draw_regions(bands, band_count, draw_region, &replay);
+    uint64_t raster_end   = lite_cpu_ticks();
+
+    LiteRendererStats raster = lite_renderer_take_stats();
+    stats.dirty_rects        = rect_count;
+    stats.pixels             = raster.pixels;
+    stats.glyphs             = raster.glyphs;
+    stats.hash_time          = ticks_to_ms(hashed - start);
+    stats.raster_time        = ticks_to_ms(raster_end - raster_start);
+
+    LiteRect surface = {0};
+    lite_renderer_get_size(&surface.width, &surface.height);
+    if (show_debug)
+    {
+        for (int32_t i = 0; i < rect_count; i++)
+        {
+            LiteRect r = rect_buf[i];
+            lite_renderer_set_clip_rect(intersect_rects(r, surface));
+            LiteColor color = {.r = rand(), .g = rand(), .b = rand(), .a = 50};
+            lite_draw_rect(r, color);
         }
     }
 
+    if (show_hud)
+    {
+        draw_hud(surface);
+    }
+    lite_renderer_unlock_surface();
+
+    /* update dirty rects and moved regions */
+    uint64_t present_start = lite_cpu_ticks();
+    if (moved_count > 0)
+    {
+        LiteRect* present = (LiteRect*)lite_arena_acquire(
+            frame_buf, (rect_count + moved_count) * sizeof(LiteRect));
+        memcpy(present, rect_buf, rect_count * sizeof(LiteRect));
+        memcpy(present + rect_count, moved, moved_count * sizeof(LiteRect));
+        lite_renderer_update_rects(present, rect_count + moved_count);
+    }
+    else if (rect_count > 0)
+    {
+        lite_renderer_update_rects(rect_buf, rect_count);
+    }
+    stats.present_time = ticks_to_ms(lite_cpu_ticks() - present_start);
+
     /* swap cell buffer and reset */
-    uint32_t* tmp = cells;
+    uint64_t* tmp = cells;
     cells         = cells_prev;
     cells_prev    = tmp;
-    first_command = nullptr;
-    lite_arena_end_temp(command_buf_temp);
+
+    ScrollState* scroll_tmp = scroll;
+    scroll                  = scroll_prev;
+    scroll_prev             = scroll_tmp;
+    lite_arena_end_temp(frame_buf_temp);
+
+    /* record this frame for the hud */
+    uint64_t end     = lite_cpu_ticks();
+    stats.frame_time = ticks_to_ms(end - start);
+    hud_frame_ms[hud_sample] = hud_last_ticks ? (float)ticks_to_ms(end - hud_last_ticks) : 0.0f;
+    hud_cache_ms[hud_sample] = (float)stats.frame_time;
+    hud_sample               = (hud_sample + 1) % HUD_SAMPLES;
+    hud_last_ticks           = end;
 }
 
 
-//! EOF
+void lite_rencache_end_frame(void)
+{
+    lite_rencache_flush_ffi();
+
+    if (trace_file)
+    {
+        trace_frame();
+    }
+
+    /* glyphs finished in the background are drawn this frame */
+    frame->glyphs_ready = lite_poll_glyphs();
+    pending_glyphs      = frame->pending_count > 0;
+
+    /* the frame drawn before gives its buffers back for the next one */
+    wait_render();
+    Frame* recorded      = frame;
+    frame                = recorded == &frames[0] ? &frames[1] : &frames[0];
+    frame->size          = 0;
+    frame->count         = 0;
+    frame->pending_count = 0;
+    frame->glyphs_ready  = false;
+    frame->invalidate    = false;
+    frame->free_fonts    = false;
+
+    /* fonts are freed on the main thread once drawn with for the last time,
+    ** and the first present shows the window, which wants the main thread */
+    if (render_thread && render_async && render_presented && !recorded->free_fonts)
+    {
+        lite_mutex_lock(render_mutex);
+        render_job = recorded;
+        lite_condition_signal(render_wake);
+        lite_mutex_unlock(render_mutex);
+        return;
+    }
+
+    render_frame(recorded);
+    render_presented = true;
+    if (render_thread)
+    {
+        lite_mutex_lock(render_mutex);
+        drawn_stats = stats;
+        lite_mutex_unlock(render_mutex);
+    }
+
+    if (recorded->free_fonts)
+    {
+        Command* cmd = nullptr;
+        while (next_command(recorded, &cmd))
+        {
+            if (command_type(cmd) == FREE_FONT)
+            {
+                lite_free_font(((FontCommand*)cmd)->font);
+            }
+        }
+    }
+}
 
+
+//! EOF
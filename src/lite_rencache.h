@@ -5,15 +5,68 @@
 #include "lite_renderer.h"
 
 
+/// A token of a line for lite_rencache_draw_tokens
+typedef struct LiteTextToken
+{
+    LiteStringView  text;
+    LiteColor       color;
+} LiteTextToken;
+
+
+/// Counters of the last frame drawn, times in milliseconds
+typedef struct LiteRencacheStats
+{
+    int32_t command_count;
+    int32_t command_bytes;
+    int32_t dirty_cells;
+    int32_t dirty_rects;
+    int64_t pixels;         // pixels rasterized while redrawing dirty rects
+    int64_t glyphs;         // glyphs blitted while redrawing dirty rects
+    double  hash_time;      // collecting, culling and hashing commands
+    double  raster_time;    // redrawing dirty rects
+    double  present_time;   // lite_window_update_rects
+    double  frame_time;     // whole end_frame, or the render thread's part of it
+} LiteRencacheStats;
+
+
 void        lite_rencache_init(void);
 void        lite_rencache_deinit(void);
 
+/// Hash, rasterize and present frames on a render thread, end_frame then
+/// returns once the frame before is drawn; frames freeing fonts, and the
+/// first frame, are still drawn in place. The thread is started by enabling
+/// it and stopped by disabling it, which waits for the frame being drawn,
+/// for output that can be read right after end_frame
+void        lite_rencache_set_async(bool enable);
+bool        lite_rencache_get_async(void);
+
+/// Wait until the frame handed to the render thread is drawn and presented
+void        lite_rencache_wait(void);
+
 void        lite_rencache_show_debug(bool enable);
+void        lite_rencache_show_hud(bool enable);
+void        lite_rencache_get_stats(LiteRencacheStats* stats);
+
+/// Record the commands of every frame to a trace file until stopped, see lite_rencache_trace.h
+bool        lite_rencache_start_trace(LiteStringView filename);
+void        lite_rencache_stop_trace(void);
+void        lite_rencache_set_cell_size(int32_t size);
+int32_t     lite_rencache_get_cell_size(void);
+void        lite_rencache_set_merge_threshold(int32_t cells);
+int32_t     lite_rencache_get_merge_threshold(void);
 void        lite_rencache_free_font(LiteFont* font);
 void        lite_rencache_set_clip_rect(LiteRect rect);
 void        lite_rencache_draw_rect(LiteRect rect, LiteColor color);
 int32_t     lite_rencache_draw_text(LiteFont* font, LiteStringView text, int32_t x, int32_t y, LiteColor color);
 
+/// Draw the tokens of a line one after another as a single command, returns
+/// the x after the last one
+int32_t     lite_rencache_draw_tokens(LiteFont* font, const LiteTextToken* tokens, int32_t count, int32_t x, int32_t y);
+
+/// Whether the last frame drew text with glyphs still rasterizing, they are
+/// drawn blank until then so keep drawing frames while this is true
+bool        lite_rencache_has_pending_glyphs(void);
+
 void        lite_rencache_invalidate(void);
 void        lite_rencache_begin_frame(void);
 void        lite_rencache_end_frame(void);
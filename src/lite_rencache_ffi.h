@@ -0,0 +1,67 @@
+#pragma once
+
+#include "lite_meta.h"
+#include "lite_renderer.h"
+
+// -----------------------------------------------------------------
+// C ABI of the render cache for the LuaJIT FFI
+//
+// Lua gets it with:
+//     local ffi = require("ffi")
+//     ffi.cdef(renderer.ffi_cdef)
+//     local rc  = ffi.cast("LiteRencacheFfi*", renderer.get_ffi())
+//
+// Clip rects and rects are written straight into rc.commands, with
+// rc.count bumped after each, and rc.flush() called once rc.count
+// reaches rc.capacity. They are pushed to the render cache in order
+// by the flush, by any other renderer call and at the end of the
+// frame, so both paths can be mixed. Colors are packed as 0xrrggbbaa.
+//
+// Text is drawn with rc.draw_text(font, text, #text, x, y, color),
+// a font being ffi.cast("LiteFont**", font)[0] of a renderer.font.
+//
+// The declarations below are the cdef string as well, only append
+// to them to keep scripts written against them working.
+// -----------------------------------------------------------------
+
+#define LITE_RENCACHE_FFI_DECLARATIONS                                          \
+    typedef struct LiteFont LiteFont;                                           \
+                                                                                \
+    enum                                                                        \
+    {                                                                           \
+        LITE_RENCACHE_FFI_SET_CLIP,                                             \
+        LITE_RENCACHE_FFI_DRAW_RECT,                                            \
+    };                                                                          \
+                                                                                \
+    typedef struct LiteRencacheFfiCommand                                       \
+    {                                                                           \
+        int32_t     type;                                                       \
+        int32_t     x, y, width, height;                                        \
+        uint32_t    color;                                                      \
+    } LiteRencacheFfiCommand;                                                   \
+                                                                                \
+    typedef struct LiteRencacheFfi                                              \
+    {                                                                           \
+        LiteRencacheFfiCommand* commands;                                       \
+        int32_t                 count;                                          \
+        int32_t                 capacity;                                       \
+        void                    (*flush)(void);                                 \
+        int32_t                 (*draw_text)(LiteFont* font, const char* text,  \
+                                             size_t length, int32_t x,          \
+                                             int32_t y, uint32_t color);        \
+    } LiteRencacheFfi;
+
+LITE_RENCACHE_FFI_DECLARATIONS
+
+#define LITE_RENCACHE_FFI_STRING_(...) #__VA_ARGS__
+#define LITE_RENCACHE_FFI_STRING(...)  LITE_RENCACHE_FFI_STRING_(__VA_ARGS__)
+#define LITE_RENCACHE_FFI_CDEF         LITE_RENCACHE_FFI_STRING(LITE_RENCACHE_FFI_DECLARATIONS)
+
+
+/// The batch Lua writes into, valid between lite_rencache_init and lite_rencache_deinit
+LiteRencacheFfi* lite_rencache_get_ffi(void);
+
+/// Push the commands written into the batch to the render cache
+void        lite_rencache_flush_ffi(void);
+
+//! EOF
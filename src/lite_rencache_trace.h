@@ -0,0 +1,51 @@
+#pragma once
+
+#include "lite_meta.h"
+
+// -----------------------------------------------------------------
+// Render trace format, written by lite_rencache_start_trace and read
+// by the replay tool (tools/lite_replay.c)
+//
+// All values are little-endian 32-bit, the file is:
+//     u32 LITE_TRACE_MAGIC, u32 LITE_TRACE_VERSION, records...
+//
+// Records start with a u32 tag:
+//     LiteTraceRecord_Font:       u32 id, f32 size, u32 length, filename bytes
+//     LiteTraceRecord_Invalidate: (empty)
+//     LiteTraceRecord_Frame:      i32 width, i32 height, u32 count, commands...
+//
+// Commands start with a u32 type:
+//     LiteTraceCommand_SetClip:   i32 x, y, width, height
+//     LiteTraceCommand_DrawRect:  i32 x, y, width, height, u32 color (bgra)
+//     LiteTraceCommand_DrawText:  u32 font, i32 x, y, u32 color, i32 tab_width,
+//                                 u32 length, text bytes
+//     LiteTraceCommand_FreeFont:  u32 font
+//     LiteTraceCommand_DrawTokens: u32 font, i32 x, y, i32 tab_width, u32 count,
+//                                 count * (u32 length, u32 color), text bytes
+//
+// A font record always comes before the first frame using its id, ids
+// are reused once their font is freed
+// -----------------------------------------------------------------
+
+#define LITE_TRACE_MAGIC   0x4352544cu // "LTRC"
+#define LITE_TRACE_VERSION 2 // 2 added LiteTraceCommand_DrawTokens
+
+
+typedef enum LiteTraceRecord
+{
+    LiteTraceRecord_Font,
+    LiteTraceRecord_Invalidate,
+    LiteTraceRecord_Frame,
+} LiteTraceRecord;
+
+
+typedef enum LiteTraceCommand
+{
+    LiteTraceCommand_SetClip,
+    LiteTraceCommand_DrawRect,
+    LiteTraceCommand_DrawText,
+    LiteTraceCommand_FreeFont,
+    LiteTraceCommand_DrawTokens,
+} LiteTraceCommand;
+
+//! EOF
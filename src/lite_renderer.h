@@ -22,13 +22,70 @@ struct alignas(4) LiteRect
 };
 
 
+/// Draw callback for one region, worker is in [0, lite_renderer_worker_count())
+/// @note(maihd): called from multiple threads at once, with the clip set to region
+typedef void LiteRegionDrawFunc(void* userdata, LiteRect region, int32_t worker);
+
+
+/// Pixel kernel sets, the best one the CPU supports is picked at init
+typedef enum LitePixelKernels
+{
+    LitePixelKernels_Scalar,
+    LitePixelKernels_SSE2,
+    LitePixelKernels_AVX2,
+    LitePixelKernels_NEON,
+    LitePixelKernels_COUNT
+} LitePixelKernels;
+
+
+/// Rasterization counters, summed over all threads that draw
+typedef struct LiteRendererStats
+{
+    int64_t pixels;     // pixels written by rects, images and glyphs
+    int64_t glyphs;     // glyphs that touched at least one pixel
+} LiteRendererStats;
+
+
+/// Renderer resources alive right now, a count that keeps growing is a leak
+typedef struct LiteRendererMemory
+{
+    int32_t fonts;          // fonts loaded and not freed yet
+    int32_t faces;          // font files mapped, shared by the fonts using them
+    int32_t images;
+    int64_t face_bytes;     // font file bytes mapped
+    int64_t atlas_bytes;    // glyph atlas pages of every font
+    int64_t image_bytes;
+} LiteRendererMemory;
+
+
 void        lite_renderer_init(void);
 void        lite_renderer_deinit(void);
 
 void        lite_renderer_update_rects(LiteRect* rects, int32_t count);
 void        lite_renderer_set_clip_rect(LiteRect rect);
+void        lite_renderer_scroll_rect(LiteRect rect, int32_t dy);
 void        lite_renderer_get_size(int32_t* x, int32_t* y);
 
+int32_t     lite_renderer_worker_count(void);
+void        lite_renderer_draw_regions(const LiteRect* regions, int32_t count, LiteRegionDrawFunc* func, void* userdata);
+
+/// Held by lite_renderer_draw_regions, scrolls and presents, and by the glyph
+/// cache when it changes, so frames can be drawn on another thread while the
+/// main thread measures text; the window holds it while replacing the
+/// surface. Nests on one thread
+void        lite_renderer_lock_surface(void);
+void        lite_renderer_unlock_surface(void);
+
+/// Return the counters gathered since the previous call and reset them
+LiteRendererStats lite_renderer_take_stats(void);
+
+/// Count the fonts, images and their memory still alive
+LiteRendererMemory lite_renderer_get_memory(void);
+
+/// Force a pixel kernel set (for benchmarks), false when the CPU doesn't support it
+bool        lite_renderer_set_pixel_kernels(LitePixelKernels kernels);
+LitePixelKernels lite_renderer_get_pixel_kernels(void);
+
 LiteImage*  lite_new_image(int32_t width, int32_t height);
 void        lite_free_image(LiteImage* image);
 
@@ -39,9 +96,58 @@ int         lite_get_font_tab_width(LiteFont* font);
 int         lite_get_font_width(LiteFont* font, LiteStringView text);
 int         lite_get_font_height(LiteFont* font);
 
+/// Box around a pen at the top left of a line that any glyph of the font
+/// inks, wider than the advances for italics and overhangs
+LiteRect    lite_get_font_ink(LiteFont* font);
+bool        lite_is_font_fixed_pitch(LiteFont* font);
+
+/// Layout for carets and hit-testing, in byte offsets of utf-8 text with
+/// tabs as wide as the font's tab width: xs gets the x of every byte and
+/// the width last (text.length + 1 values), bytes inside a character take
+/// its x; the character edge closest to x; the x of an offset
+void        lite_get_font_advances(LiteFont* font, LiteStringView text, int32_t* xs);
+size_t      lite_get_font_offset_at(LiteFont* font, LiteStringView text, int32_t x);
+int32_t     lite_get_font_x_at(LiteFont* font, LiteStringView text, size_t offset);
+
+LiteStringView lite_get_font_filename(LiteFont* font);
+float       lite_get_font_size(LiteFont* font);
+
+/// Atlas memory a font keeps for its glyphs before evicting the least
+/// recently used ones, a soft limit since glyphs drawn this frame stay
+void        lite_set_glyph_budget(size_t bytes);
+size_t      lite_get_glyph_budget(void);
+
+/// Fonts loaded while enabled draw every size from signed distance fields
+/// rasterized once per font file, so zooming loads no glyphs; small text
+/// is softer than with glyphs baked per size
+void        lite_set_glyph_sdf(bool enable);
+bool        lite_get_glyph_sdf(void);
+
+/// Directory to keep the ascii glyphs of fonts in between runs, so fonts
+/// loaded again skip rasterizing them; an empty path disables it
+void        lite_set_glyph_cache_dir(LiteStringView path);
+
+/// Glyphs are rasterized on a background thread by default, text using
+/// them is drawn blank, with the right advances, until they are installed;
+/// disabling it finishes the queued glyphs, for deterministic output
+void        lite_set_glyph_async(bool enable);
+
+/// Install the glyphs rasterized in the background, true if there were any,
+/// and load those missed while a frame was being drawn
+bool        lite_poll_glyphs(void);
+
+/// Whether text has glyphs still being rasterized
+bool        lite_is_text_pending(LiteFont* font, LiteStringView text);
+
 void        lite_draw_rect(LiteRect rect, LiteColor color);
 void        lite_draw_image(LiteImage* image, LiteRect* sub, int32_t x, int32_t y, LiteColor color);
-int         lite_draw_text(LiteFont* font, LiteStringView text, int32_t x, int32_t y, LiteColor color);
+/// Draw text, glyphs outside the clip rect are passed over by their advances;
+/// returns the x after the whole text
+int         lite_draw_text(LiteFont* font, LiteStringView text, int32_t tab_width, int32_t x, int32_t y, LiteColor color);
+
+/// Part of text that can draw between the columns left and right when drawn
+/// at *x, which is moved to where that part starts
+LiteStringView lite_clip_text(LiteFont* font, LiteStringView text, int32_t tab_width, int32_t* x, int32_t left, int32_t right);
 
 //! EOF
 
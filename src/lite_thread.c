@@ -0,0 +1,9 @@
+#if defined(LITE_SYSTEM_SDL2)
+#include "platforms/lite_thread_sdl2.c"
+#elif defined(_WIN32)
+#include "platforms/lite_thread_win32.c"
+#else
+#include "platforms/lite_thread_posix.c"
+#endif
+
+//! EOF
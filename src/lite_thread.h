@@ -0,0 +1,36 @@
+#pragma once
+
+#include "lite_meta.h"
+
+
+typedef struct LiteThread    LiteThread;
+typedef struct LiteMutex     LiteMutex;
+typedef struct LiteCondition LiteCondition;
+
+typedef int32_t LiteThreadFunc(void* userdata);
+
+
+int32_t         lite_cpu_count(void);
+
+LiteThread*     lite_thread_create(LiteThreadFunc* func, const char* name, void* userdata);
+void            lite_thread_join(LiteThread* thread);
+
+LiteMutex*      lite_mutex_create(void);
+void            lite_mutex_destroy(LiteMutex* mutex);
+void            lite_mutex_lock(LiteMutex* mutex);
+bool            lite_mutex_try_lock(LiteMutex* mutex);
+void            lite_mutex_unlock(LiteMutex* mutex);
+
+LiteCondition*  lite_condition_create(void);
+void            lite_condition_destroy(LiteCondition* condition);
+void            lite_condition_wait(LiteCondition* condition, LiteMutex* mutex);
+void            lite_condition_signal(LiteCondition* condition);
+void            lite_condition_broadcast(LiteCondition* condition);
+
+/// Atomically add to value, return the value before the addition
+int32_t         lite_atomic_add(volatile int32_t* value, int32_t add);
+
+/// Atomically read a value other threads add to
+int32_t         lite_atomic_load(const volatile int32_t* value);
+
+//! EOF
@@ -39,6 +39,12 @@ int main(int argc, char** argv)
     lite_renderer_init();
     lite_rencache_init();
 
+    // @note(maihd): the native window replaces its surface under the renderer's
+    //     lock, sdl2 wants its window surface on the main thread
+#if !defined(LITE_SYSTEM_SDL2)
+    lite_rencache_set_async(true);
+#endif
+
     const LiteStartupParams startup_params = {
         .argc = (uint32_t)argc,
         .argv = (const char**)argv,
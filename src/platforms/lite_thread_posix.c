@@ -0,0 +1,147 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "lite_thread.h"
+
+
+typedef struct LiteThreadStart
+{
+    pthread_t       handle;
+    LiteThreadFunc* func;
+    void*           userdata;
+} LiteThreadStart;
+
+
+static void* lite_thread_start(void* param)
+{
+    LiteThreadStart* start = (LiteThreadStart*)param;
+    return (void*)(intptr_t)start->func(start->userdata);
+}
+
+
+int32_t lite_cpu_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int32_t)count : 1;
+}
+
+
+LiteThread* lite_thread_create(LiteThreadFunc* func, const char* name, void* userdata)
+{
+    assert(func != nullptr);
+    (void)name; // @todo(maihd): pthread_setname_np is not portable
+
+    LiteThreadStart* start = (LiteThreadStart*)malloc(sizeof(LiteThreadStart));
+    if (start == nullptr)
+    {
+        return nullptr;
+    }
+
+    start->func     = func;
+    start->userdata = userdata;
+
+    if (pthread_create(&start->handle, nullptr, lite_thread_start, start) != 0)
+    {
+        free(start);
+        return nullptr;
+    }
+
+    return (LiteThread*)start;
+}
+
+
+void lite_thread_join(LiteThread* thread)
+{
+    LiteThreadStart* start = (LiteThreadStart*)thread;
+    pthread_join(start->handle, nullptr);
+    free(start);
+}
+
+
+LiteMutex* lite_mutex_create(void)
+{
+    pthread_mutex_t* mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    if (mutex != nullptr)
+    {
+        pthread_mutex_init(mutex, nullptr);
+    }
+    return (LiteMutex*)mutex;
+}
+
+
+void lite_mutex_destroy(LiteMutex* mutex)
+{
+    pthread_mutex_destroy((pthread_mutex_t*)mutex);
+    free(mutex);
+}
+
+
+void lite_mutex_lock(LiteMutex* mutex)
+{
+    pthread_mutex_lock((pthread_mutex_t*)mutex);
+}
+
+
+bool lite_mutex_try_lock(LiteMutex* mutex)
+{
+    return pthread_mutex_trylock((pthread_mutex_t*)mutex) == 0;
+}
+
+
+void lite_mutex_unlock(LiteMutex* mutex)
+{
+    pthread_mutex_unlock((pthread_mutex_t*)mutex);
+}
+
+
+LiteCondition* lite_condition_create(void)
+{
+    pthread_cond_t* cv = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    if (cv != nullptr)
+    {
+        pthread_cond_init(cv, nullptr);
+    }
+    return (LiteCondition*)cv;
+}
+
+
+void lite_condition_destroy(LiteCondition* condition)
+{
+    pthread_cond_destroy((pthread_cond_t*)condition);
+    free(condition);
+}
+
+
+void lite_condition_wait(LiteCondition* condition, LiteMutex* mutex)
+{
+    pthread_cond_wait((pthread_cond_t*)condition, (pthread_mutex_t*)mutex);
+}
+
+
+void lite_condition_signal(LiteCondition* condition)
+{
+    pthread_cond_signal((pthread_cond_t*)condition);
+}
+
+
+void lite_condition_broadcast(LiteCondition* condition)
+{
+    pthread_cond_broadcast((pthread_cond_t*)condition);
+}
+
+
+int32_t lite_atomic_add(volatile int32_t* value, int32_t add)
+{
+    return __atomic_fetch_add(value, add, __ATOMIC_SEQ_CST);
+}
+
+
+int32_t lite_atomic_load(const volatile int32_t* value)
+{
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+//! EOF
@@ -0,0 +1,99 @@
+#include <assert.h>
+
+#include <SDL2/SDL.h>
+
+#include "lite_thread.h"
+
+
+int32_t lite_cpu_count(void)
+{
+    return (int32_t)SDL_GetCPUCount();
+}
+
+
+LiteThread* lite_thread_create(LiteThreadFunc* func, const char* name, void* userdata)
+{
+    assert(func != nullptr);
+    return (LiteThread*)SDL_CreateThread((SDL_ThreadFunction)func, name, userdata);
+}
+
+
+void lite_thread_join(LiteThread* thread)
+{
+    SDL_WaitThread((SDL_Thread*)thread, nullptr);
+}
+
+
+LiteMutex* lite_mutex_create(void)
+{
+    return (LiteMutex*)SDL_CreateMutex();
+}
+
+
+void lite_mutex_destroy(LiteMutex* mutex)
+{
+    SDL_DestroyMutex((SDL_mutex*)mutex);
+}
+
+
+void lite_mutex_lock(LiteMutex* mutex)
+{
+    SDL_LockMutex((SDL_mutex*)mutex);
+}
+
+
+bool lite_mutex_try_lock(LiteMutex* mutex)
+{
+    return SDL_TryLockMutex((SDL_mutex*)mutex) == 0;
+}
+
+
+void lite_mutex_unlock(LiteMutex* mutex)
+{
+    SDL_UnlockMutex((SDL_mutex*)mutex);
+}
+
+
+LiteCondition* lite_condition_create(void)
+{
+    return (LiteCondition*)SDL_CreateCond();
+}
+
+
+void lite_condition_destroy(LiteCondition* condition)
+{
+    SDL_DestroyCond((SDL_cond*)condition);
+}
+
+
+void lite_condition_wait(LiteCondition* condition, LiteMutex* mutex)
+{
+    SDL_CondWait((SDL_cond*)condition, (SDL_mutex*)mutex);
+}
+
+
+void lite_condition_signal(LiteCondition* condition)
+{
+    SDL_CondSignal((SDL_cond*)condition);
+}
+
+
+void lite_condition_broadcast(LiteCondition* condition)
+{
+    SDL_CondBroadcast((SDL_cond*)condition);
+}
+
+
+int32_t lite_atomic_add(volatile int32_t* value, int32_t add)
+{
+    static_assert(sizeof(SDL_atomic_t) == sizeof(int32_t), "SDL_atomic_t must be a plain int");
+    return (int32_t)SDL_AtomicAdd((SDL_atomic_t*)value, add);
+}
+
+
+int32_t lite_atomic_load(const volatile int32_t* value)
+{
+    return (int32_t)SDL_AtomicGet((SDL_atomic_t*)value);
+}
+
+//! EOF
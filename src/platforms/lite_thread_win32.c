@@ -0,0 +1,148 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "lite_thread.h"
+
+
+typedef struct LiteThreadStart
+{
+    LiteThreadFunc* func;
+    void*           userdata;
+} LiteThreadStart;
+
+
+static DWORD WINAPI lite_thread_start(LPVOID param)
+{
+    LiteThreadStart start = *(LiteThreadStart*)param;
+    free(param);
+
+    return (DWORD)start.func(start.userdata);
+}
+
+
+int32_t lite_cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int32_t)info.dwNumberOfProcessors;
+}
+
+
+LiteThread* lite_thread_create(LiteThreadFunc* func, const char* name, void* userdata)
+{
+    assert(func != nullptr);
+    (void)name; // @todo(maihd): SetThreadDescription is not available on older Windows versions
+
+    LiteThreadStart* start = (LiteThreadStart*)malloc(sizeof(LiteThreadStart));
+    if (start == nullptr)
+    {
+        return nullptr;
+    }
+
+    start->func     = func;
+    start->userdata = userdata;
+
+    HANDLE hThread = CreateThread(nullptr, 0, lite_thread_start, start, 0, nullptr);
+    if (hThread == nullptr)
+    {
+        free(start);
+        return nullptr;
+    }
+
+    return (LiteThread*)hThread;
+}
+
+
+void lite_thread_join(LiteThread* thread)
+{
+    WaitForSingleObject((HANDLE)thread, INFINITE);
+    CloseHandle((HANDLE)thread);
+}
+
+
+LiteMutex* lite_mutex_create(void)
+{
+    SRWLOCK* lock = (SRWLOCK*)malloc(sizeof(SRWLOCK));
+    if (lock != nullptr)
+    {
+        InitializeSRWLock(lock);
+    }
+    return (LiteMutex*)lock;
+}
+
+
+void lite_mutex_destroy(LiteMutex* mutex)
+{
+    free(mutex);
+}
+
+
+void lite_mutex_lock(LiteMutex* mutex)
+{
+    AcquireSRWLockExclusive((SRWLOCK*)mutex);
+}
+
+
+bool lite_mutex_try_lock(LiteMutex* mutex)
+{
+    return TryAcquireSRWLockExclusive((SRWLOCK*)mutex) != 0;
+}
+
+
+void lite_mutex_unlock(LiteMutex* mutex)
+{
+    ReleaseSRWLockExclusive((SRWLOCK*)mutex);
+}
+
+
+LiteCondition* lite_condition_create(void)
+{
+    CONDITION_VARIABLE* cv = (CONDITION_VARIABLE*)malloc(sizeof(CONDITION_VARIABLE));
+    if (cv != nullptr)
+    {
+        InitializeConditionVariable(cv);
+    }
+    return (LiteCondition*)cv;
+}
+
+
+void lite_condition_destroy(LiteCondition* condition)
+{
+    free(condition);
+}
+
+
+void lite_condition_wait(LiteCondition* condition, LiteMutex* mutex)
+{
+    SleepConditionVariableSRW((CONDITION_VARIABLE*)condition, (SRWLOCK*)mutex, INFINITE, 0);
+}
+
+
+void lite_condition_signal(LiteCondition* condition)
+{
+    WakeConditionVariable((CONDITION_VARIABLE*)condition);
+}
+
+
+void lite_condition_broadcast(LiteCondition* condition)
+{
+    WakeAllConditionVariable((CONDITION_VARIABLE*)condition);
+}
+
+
+int32_t lite_atomic_add(volatile int32_t* value, int32_t add)
+{
+    return (int32_t)InterlockedExchangeAdd((volatile LONG*)value, (LONG)add);
+}
+
+
+int32_t lite_atomic_load(const volatile int32_t* value)
+{
+    /* a compare exchange that never stores is a full barrier read */
+    return (int32_t)InterlockedCompareExchange((volatile LONG*)value, 0, 0);
+}
+
+//! EOF
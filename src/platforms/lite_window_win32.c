@@ -1292,6 +1292,9 @@ static LRESULT WINAPI lite_win32_window_proc(
         UINT width = LOWORD(lParam);
         UINT height = HIWORD(lParam);
 
+        // @note(maihd): frames may be drawn on another thread, wait for it
+        lite_renderer_lock_surface();
+
         DeleteBitmap(s_hSurfaceBitmap);
         DeleteDC(s_hSurface);
 
@@ -1311,6 +1314,8 @@ static LRESULT WINAPI lite_win32_window_proc(
         s_hSurfaceBitmap = CreateDIBSection(s_hDC, &bmi, DIB_RGB_COLORS, (void**)(&s_surface_pixels), nullptr, 0);
         SelectObject(s_hSurface, s_hSurfaceBitmap);
 
+        lite_renderer_unlock_surface();
+
 		// @note(maihd): from lua must be handle this event to repaint
 
         lite_push_event((LiteEvent){
@@ -0,0 +1,284 @@
+// -----------------------------------------------------------------
+// Render cache cell size benchmark
+//
+// Draws an editor-like 1280x800 frame (sidebar, tab bar, gutter and
+// document, caret, status bar) through the render cache and replays
+// three workloads on it at a range of cell sizes: the caret blinking,
+// a character typed per frame and the document scrolling by a few
+// pixels per frame. Prints, per frame, the pixels presented with
+// lite_window_update_rects, the pixels rasterized, the dirty rects
+// and the time spent in lite_rencache_end_frame.
+//
+// Usage: lite_bench_cells <font.ttf> [frames per case, default 50] [-m <cells>]
+//     -m, --merge-threshold <cells>
+//         clean cells a merge of dirty cells may redraw, run once per
+//         threshold to compare them on the same frames
+//
+// Build on posix (no window system needed):
+//     cc -O2 -std=c11 -fno-strict-aliasing -Isrc -DNDEBUG src/tools/lite_bench_cells.c
+//        src/tools/lite_offscreen.c src/lite_rencache.c src/lite_renderer.c src/lite_memory.c
+//        src/lite_string.c src/lite_thread.c src/lib/stb/*.c -lm -lpthread
+// -----------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lite_rencache.h"
+#include "lite_renderer.h"
+#include "lite_window.h"
+#include "tools/lite_offscreen.h"
+
+
+#define SURFACE_WIDTH   1280
+#define SURFACE_HEIGHT  800
+#define DOCUMENT_LINES  400
+#define LINE_LENGTH     128
+#define LINE_HEIGHT     19
+#define SIDEBAR_WIDTH   220
+#define TAB_HEIGHT      30
+#define STATUS_HEIGHT   24
+#define GUTTER_WIDTH    50
+#define CARET_LINE      10
+
+
+typedef enum BenchWorkload
+{
+    BenchWorkload_Blink,
+    BenchWorkload_Typing,
+    BenchWorkload_Scroll,
+    BenchWorkload_COUNT,
+} BenchWorkload;
+
+
+typedef struct BenchResult
+{
+    int64_t presented;
+    int64_t pixels;
+    double  rects;
+    double  ms;
+} BenchResult;
+
+
+static const int32_t g_cell_sizes[] = { 16, 24, 32, 48, 64, 96, 128 };
+
+static const char* g_workload_names[BenchWorkload_COUNT] = {
+    "blink", "typing", "scroll",
+};
+
+
+static LiteFont* g_font;
+static int32_t   g_char_width;
+static char      g_document[DOCUMENT_LINES][LINE_LENGTH];
+
+
+static void reset_document(void)
+{
+    for (int32_t i = 0; i < DOCUMENT_LINES; i++)
+    {
+        snprintf(g_document[i], LINE_LENGTH, "%*slocal value_%d = compute(%d, \"str\") -- trailing",
+                 (i % 5) * 4, "", i, i * 7);
+    }
+}
+
+
+static void draw_string(const char* text, int32_t x, int32_t y, LiteColor color)
+{
+    lite_rencache_draw_text(g_font, lite_string_view(text, strlen(text)), x, y, color);
+}
+
+
+static void draw_editor(int32_t scroll, int32_t caret_column, bool caret_visible)
+{
+    const LiteColor background = { .r = 40,  .g = 40,  .b = 40,  .a = 0xff };
+    const LiteColor panel      = { .r = 30,  .g = 30,  .b = 30,  .a = 0xff };
+    const LiteColor text       = { .r = 200, .g = 200, .b = 200, .a = 0xff };
+    const LiteColor dim        = { .r = 100, .g = 100, .b = 100, .a = 0xff };
+    const LiteColor caret      = { .r = 255, .g = 255, .b = 255, .a = 0xff };
+    char            buffer[64];
+
+    lite_rencache_begin_frame();
+    lite_rencache_set_clip_rect((LiteRect){ 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT });
+    lite_rencache_draw_rect((LiteRect){ 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT }, background);
+
+    /* sidebar and tab bar */
+    lite_rencache_draw_rect((LiteRect){ 0, 0, SIDEBAR_WIDTH, SURFACE_HEIGHT - STATUS_HEIGHT }, panel);
+    for (int32_t i = 0; i < 30; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "file_%02d.lua", i);
+        draw_string(buffer, 12, 8 + i * LINE_HEIGHT, text);
+    }
+    lite_rencache_draw_rect((LiteRect){ SIDEBAR_WIDTH, 0, SURFACE_WIDTH - SIDEBAR_WIDTH, TAB_HEIGHT }, panel);
+    draw_string("main.lua", SIDEBAR_WIDTH + 12, 6, text);
+
+    /* gutter and document */
+    int32_t doc_x = SIDEBAR_WIDTH + GUTTER_WIDTH + 10;
+    lite_rencache_set_clip_rect((LiteRect){
+        SIDEBAR_WIDTH, TAB_HEIGHT, SURFACE_WIDTH - SIDEBAR_WIDTH, SURFACE_HEIGHT - TAB_HEIGHT - STATUS_HEIGHT });
+    int32_t first = scroll / LINE_HEIGHT;
+    int32_t last  = first + (SURFACE_HEIGHT - TAB_HEIGHT - STATUS_HEIGHT) / LINE_HEIGHT + 1;
+    for (int32_t i = first; i <= last && i < DOCUMENT_LINES; i++)
+    {
+        int32_t y = TAB_HEIGHT + i * LINE_HEIGHT - scroll;
+        snprintf(buffer, sizeof(buffer), "%d", i + 1);
+        draw_string(buffer, SIDEBAR_WIDTH + 10, y, dim);
+        draw_string(g_document[i], doc_x, y, text);
+    }
+    if (caret_visible)
+    {
+        int32_t y = TAB_HEIGHT + CARET_LINE * LINE_HEIGHT - scroll;
+        lite_rencache_draw_rect((LiteRect){ doc_x + caret_column * g_char_width, y, 2, LINE_HEIGHT }, caret);
+    }
+
+    /* status bar */
+    lite_rencache_set_clip_rect((LiteRect){ 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT });
+    lite_rencache_draw_rect((LiteRect){ 0, SURFACE_HEIGHT - STATUS_HEIGHT, SURFACE_WIDTH, STATUS_HEIGHT }, panel);
+    snprintf(buffer, sizeof(buffer), "line %d col %d", CARET_LINE + 1, caret_column + 1);
+    draw_string(buffer, SURFACE_WIDTH - 200, SURFACE_HEIGHT - 20, text);
+}
+
+
+static void draw_workload_frame(BenchWorkload workload, int32_t frame)
+{
+    char*   line   = g_document[CARET_LINE];
+    int32_t length = (int32_t)strlen(line);
+    switch (workload)
+    {
+    case BenchWorkload_Blink:
+        draw_editor(0, 10, (frame & 1) == 0);
+        break;
+
+    case BenchWorkload_Typing:
+        if (length + 1 < LINE_LENGTH)
+        {
+            line[length++] = (char)('a' + frame % 26);
+            line[length]   = '\0';
+        }
+        draw_editor(0, length, true);
+        break;
+
+    case BenchWorkload_Scroll:
+        draw_editor((frame + 1) * 3, 10, true);
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+static BenchResult run_workload(BenchWorkload workload, int32_t frames)
+{
+    /* every workload starts from the same document, fully drawn */
+    reset_document();
+    draw_editor(0, 10, true);
+    lite_rencache_end_frame();
+    lite_offscreen_take_presented();
+
+    BenchResult result = {0};
+    for (int32_t frame = 0; frame < frames; frame++)
+    {
+        draw_workload_frame(workload, frame);
+
+        uint64_t start = lite_cpu_ticks();
+        lite_rencache_end_frame();
+        result.ms     += (double)(lite_cpu_ticks() - start) * 1000.0 / (double)lite_cpu_frequency();
+
+        LiteRencacheStats stats;
+        lite_rencache_get_stats(&stats);
+        result.pixels += stats.pixels;
+        result.rects  += (double)stats.dirty_rects;
+    }
+    result.presented = lite_offscreen_take_presented();
+
+    result.presented /= frames;
+    result.pixels    /= frames;
+    result.rects     /= frames;
+    result.ms        /= frames;
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* font_path = nullptr;
+    int32_t     frames    = 50;
+    int32_t     merge     = -1;
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--merge-threshold") == 0) && i + 1 < argc)
+        {
+            merge = atoi(argv[++i]);
+        }
+        else if (font_path == nullptr)
+        {
+            font_path = argv[i];
+        }
+        else
+        {
+            frames = atoi(argv[i]);
+        }
+    }
+
+    if (font_path == nullptr)
+    {
+        fprintf(stderr, "usage: %s <font.ttf> [frames per case] [-m <cells>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (frames <= 0)
+    {
+        frames = 50;
+    }
+
+    lite_offscreen_resize(SURFACE_WIDTH, SURFACE_HEIGHT);
+    lite_renderer_init();
+    lite_rencache_init();
+    lite_set_glyph_async(false);
+    if (merge >= 0)
+    {
+        lite_rencache_set_merge_threshold(merge);
+    }
+
+    g_font = lite_load_font(lite_string_view(font_path, strlen(font_path)), 14.0f);
+    if (g_font == nullptr)
+    {
+        fprintf(stderr, "%s: cannot load font\n", font_path);
+        lite_rencache_deinit();
+        lite_renderer_deinit();
+        lite_offscreen_free();
+        return EXIT_FAILURE;
+    }
+    g_char_width = lite_get_font_width(g_font, lite_string_lit("m"));
+
+    printf("%d frames per case, merge threshold %d, per frame:\n", frames, lite_rencache_get_merge_threshold());
+    printf("%-5s", "cell");
+    for (int32_t w = 0; w < BenchWorkload_COUNT; w++)
+    {
+        printf("  %8s presented %9s %5s %7s", g_workload_names[w], "raster", "rects", "ms");
+    }
+    printf("\n");
+
+    for (size_t c = 0; c < __count_of(g_cell_sizes); c++)
+    {
+        lite_rencache_set_cell_size(g_cell_sizes[c]);
+        printf("%-5d", lite_rencache_get_cell_size());
+        for (int32_t w = 0; w < BenchWorkload_COUNT; w++)
+        {
+            BenchResult result = run_workload((BenchWorkload)w, frames);
+            printf("  %18lld %9lld %5.1f %7.3f",
+                   (long long)result.presented, (long long)result.pixels, result.rects, result.ms);
+        }
+        printf("\n");
+    }
+
+    lite_rencache_free_font(g_font);
+    lite_rencache_begin_frame();
+    lite_rencache_end_frame();
+    lite_rencache_deinit();
+    lite_renderer_deinit();
+    lite_offscreen_free();
+    return EXIT_SUCCESS;
+}
+
+//! EOF
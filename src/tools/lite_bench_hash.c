@@ -0,0 +1,235 @@
+// -----------------------------------------------------------------
+// Render cache command hashing benchmark
+//
+// Records frames of one command type each (SET_CLIP, DRAW_RECT,
+// DRAW_TEXT and DRAW_TOKENS) through the render cache and times
+// command_key and command_hash over them the way end_frame does when it
+// updates the cells, printing nanoseconds per command along with the
+// average size of the commands.
+//
+// Usage: lite_bench_hash <font.ttf> [seconds per case, default 0.5]
+//
+// Build on posix (no window system needed):
+//     cc -O2 -std=c11 -fno-strict-aliasing -Isrc -DNDEBUG src/tools/lite_bench_hash.c
+//        src/tools/lite_offscreen.c src/lite_renderer.c src/lite_memory.c
+//        src/lite_string.c src/lite_thread.c src/lib/stb/*.c -lm -lpthread
+// -----------------------------------------------------------------
+
+/* command_key and command_hash are static, so the render cache is built
+** into this tool, like the backends are into lite_renderer.c */
+#include "lite_rencache.c"
+
+#include <ctype.h>
+
+#include "tools/lite_offscreen.h"
+
+
+#define SURFACE_WIDTH   1280
+#define SURFACE_HEIGHT  800
+#define BENCH_COMMANDS  2000
+#define BENCH_LINES     40
+#define BENCH_LINE_SIZE 128
+
+
+typedef struct BenchCase
+{
+    const char* name;
+    uint32_t    type;
+} BenchCase;
+
+
+static const BenchCase g_cases[] = {
+    { "clip",   SET_CLIP    },
+    { "rect",   DRAW_RECT   },
+    { "text",   DRAW_TEXT   },
+    { "tokens", DRAW_TOKENS },
+};
+
+
+static const LiteColor g_colors[] = {
+    { .r = 220, .g = 220, .b = 220, .a = 0xff },
+    { .r = 230, .g = 120, .b = 80,  .a = 0xff },
+    { .r = 120, .g = 200, .b = 120, .a = 0xff },
+    { .r = 100, .g = 150, .b = 230, .a = 0xff },
+};
+
+
+static LiteFont*         g_font;
+static const Command*    g_commands[BENCH_COMMANDS];
+static int32_t           g_command_count;
+static size_t            g_command_bytes;
+
+/* text hashes include the font pointer, so the sum differs from run to run
+** and only keeps the hashing from being optimized away */
+static volatile uint64_t g_hash_sum;
+
+
+static LiteStringView bench_line(char* buffer, int32_t i)
+{
+    int length = snprintf(buffer, BENCH_LINE_SIZE, "%*slocal value_%d = compute(%d, \"str\") -- trailing",
+                          (i % 5) * 4, "", i, i * 7);
+    return lite_string_view(buffer, (size_t)length);
+}
+
+
+static int32_t char_kind(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' ? 0 : c == ' ' ? 1 : 2;
+}
+
+
+/* words and whitespace runs become tokens, symbols are tokens of their own */
+static int32_t bench_tokens(LiteStringView line, LiteTextToken* tokens, int32_t capacity)
+{
+    int32_t count = 0;
+    size_t  start = 0;
+    while (start < line.length && count < capacity)
+    {
+        int32_t kind = char_kind(line.buffer[start]);
+        size_t  end  = start + 1;
+        while (kind != 2 && end < line.length && char_kind(line.buffer[end]) == kind)
+        {
+            end++;
+        }
+
+        tokens[count++] = (LiteTextToken){
+            .text  = lite_string_view(line.buffer + start, end - start),
+            .color = g_colors[(kind + count) % __count_of(g_colors)],
+        };
+        start = end;
+    }
+    return count;
+}
+
+
+static void record_case(const BenchCase* bench)
+{
+    char          buffer[BENCH_LINE_SIZE];
+    LiteTextToken tokens[64];
+
+    lite_rencache_begin_frame();
+    for (int32_t i = 0; i < BENCH_COMMANDS; i++)
+    {
+        int32_t y = (i % BENCH_LINES) * 19;
+        switch (bench->type)
+        {
+        case SET_CLIP:
+            lite_rencache_set_clip_rect((LiteRect){ i % 200, y, SURFACE_WIDTH - i % 300, 19 + i % 50 });
+            break;
+
+        case DRAW_RECT:
+            lite_rencache_draw_rect((LiteRect){ i % 200, y, 2 + i % 900, 19 }, g_colors[i % __count_of(g_colors)]);
+            break;
+
+        case DRAW_TEXT:
+            lite_rencache_draw_text(g_font, bench_line(buffer, i), 10, y, g_colors[i % __count_of(g_colors)]);
+            break;
+
+        case DRAW_TOKENS:
+        {
+            int32_t count = bench_tokens(bench_line(buffer, i), tokens, (int32_t)__count_of(tokens));
+            lite_rencache_draw_tokens(g_font, tokens, count, 10, y);
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    /* keep the commands of the case, the frame buffer stays put until the
+    ** next begin_frame */
+    g_command_count = 0;
+    g_command_bytes = 0;
+    Command* cmd    = nullptr;
+    while (next_command(frame, &cmd))
+    {
+        if (command_type(cmd) == bench->type && g_command_count < BENCH_COMMANDS)
+        {
+            g_commands[g_command_count++] = cmd;
+            g_command_bytes              += command_size(cmd);
+        }
+    }
+}
+
+
+static uint64_t hash_commands(void)
+{
+    uint64_t sum = 0;
+    for (int32_t i = 0; i < g_command_count; i++)
+    {
+        sum += command_hash(command_key(g_commands[i]), g_commands[i]);
+    }
+    return sum;
+}
+
+
+static double nanoseconds_per_command(double seconds)
+{
+    uint64_t frequency = lite_cpu_frequency();
+    uint64_t budget    = (uint64_t)(seconds * (double)frequency);
+    uint64_t start     = lite_cpu_ticks();
+    uint64_t elapsed   = 0;
+    int64_t  hashed    = 0;
+    while (elapsed < budget)
+    {
+        g_hash_sum = hash_commands();
+        hashed    += g_command_count;
+        elapsed    = lite_cpu_ticks() - start;
+    }
+
+    return hashed > 0 ? (double)elapsed * 1e9 / (double)frequency / (double)hashed : 0.0;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <font.ttf> [seconds per case]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double seconds = argc > 2 ? atof(argv[2]) : 0.5;
+    if (seconds <= 0.0)
+    {
+        seconds = 0.5;
+    }
+
+    lite_offscreen_resize(SURFACE_WIDTH, SURFACE_HEIGHT);
+    lite_renderer_init();
+    lite_rencache_init();
+    lite_set_glyph_async(false);
+
+    g_font = lite_load_font(lite_string_view(argv[1], strlen(argv[1])), 14.0f);
+    if (g_font == nullptr)
+    {
+        fprintf(stderr, "%s: cannot load font\n", argv[1]);
+        lite_rencache_deinit();
+        lite_renderer_deinit();
+        lite_offscreen_free();
+        return EXIT_FAILURE;
+    }
+
+    printf("%-8s %8s %10s %10s\n", "case", "count", "bytes/cmd", "ns/cmd");
+    for (size_t c = 0; c < __count_of(g_cases); c++)
+    {
+        record_case(&g_cases[c]);
+
+        double ns = nanoseconds_per_command(seconds);
+        printf("%-8s %8d %10.1f %10.2f\n", g_cases[c].name, g_command_count,
+               g_command_count ? (double)g_command_bytes / g_command_count : 0.0, ns);
+
+        lite_rencache_end_frame();
+    }
+
+    lite_rencache_free_font(g_font);
+    lite_rencache_begin_frame();
+    lite_rencache_end_frame();
+    lite_rencache_deinit();
+    lite_renderer_deinit();
+    lite_offscreen_free();
+    return EXIT_SUCCESS;
+}
+
+//! EOF
@@ -0,0 +1,196 @@
+// -----------------------------------------------------------------
+// Pixel kernel microbenchmark
+//
+// Runs lite_draw_rect, and lite_draw_text when a font is given, with
+// every pixel kernel set the CPU supports on a 4K offscreen surface and
+// prints pixels per second for each, along with a checksum that must
+// match the scalar kernels.
+//
+// Usage: lite_bench_pixels [seconds per case, default 0.5] [font.ttf]
+//
+// Build on posix (no window system needed):
+//     cc -O2 -std=c11 -fno-strict-aliasing -Isrc -DNDEBUG src/tools/lite_bench_pixels.c
+//        src/tools/lite_offscreen.c src/lite_renderer.c src/lite_memory.c
+//        src/lite_string.c src/lite_thread.c src/lib/stb/*.c -lm -lpthread
+// -----------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lite_renderer.h"
+#include "lite_window.h"
+#include "tools/lite_offscreen.h"
+
+
+#define SURFACE_WIDTH  3840
+#define SURFACE_HEIGHT 2160
+
+
+typedef struct BenchCase
+{
+    const char* name;
+    LiteRect    rect;
+    LiteColor   color;
+    const char* text;   /* draws this line at rect.x, rect.y when not null */
+} BenchCase;
+
+
+static const BenchCase g_cases[] = {
+    { "fill 4k",       { 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT }, { .r = 40,  .g = 40,  .b = 40,  .a = 0xff }, nullptr },
+    { "blend 4k",      { 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT }, { .r = 20,  .g = 20,  .b = 60,  .a = 230  }, nullptr },
+    { "fill line",     { 3, 5, 1200, 20 },                      { .r = 50,  .g = 50,  .b = 50,  .a = 0xff }, nullptr },
+    { "blend line",    { 3, 5, 1200, 20 },                      { .r = 80,  .g = 120, .b = 200, .a = 100  }, nullptr },
+    { "blend caret",   { 7, 5, 2, 20 },                         { .r = 255, .g = 255, .b = 255, .a = 128  }, nullptr },
+    { "text",          { 3, 5, 0, 0 },                          { .r = 220, .g = 200, .b = 160, .a = 0xff },
+      "local function draw_line(self, idx, x, y) -- render one document line" },
+    { "text faded",    { 3, 5, 0, 0 },                          { .r = 220, .g = 200, .b = 160, .a = 90   },
+      "local function draw_line(self, idx, x, y) -- render one document line" },
+};
+
+
+static LiteFont* g_font;
+
+
+static const char* g_kernel_names[LitePixelKernels_COUNT] = {
+    "scalar", "sse2", "avx2", "neon",
+};
+
+
+static void reset_surface(void)
+{
+    /* a fixed gradient, so blends have varied destinations to work on */
+    int32_t    width, height;
+    LiteColor* pixels = (LiteColor*)lite_window_surface(&width, &height);
+    for (int32_t y = 0; y < height; y++)
+    {
+        for (int32_t x = 0; x < width; x++)
+        {
+            pixels[x + y * width] = (LiteColor){
+                .r = (uint8_t)x, .g = (uint8_t)y, .b = (uint8_t)(x ^ y), .a = (uint8_t)(x + y),
+            };
+        }
+    }
+}
+
+
+static void draw_case(const BenchCase* bench)
+{
+    if (bench->text)
+    {
+        LiteStringView text = lite_string_view(bench->text, strlen(bench->text));
+        lite_draw_text(g_font, text, 0, bench->rect.x, bench->rect.y, bench->color);
+    }
+    else
+    {
+        lite_draw_rect(bench->rect, bench->color);
+    }
+}
+
+
+static uint32_t checksum_case(const BenchCase* bench)
+{
+    reset_surface();
+    for (int32_t i = 0; i < 3; i++)
+    {
+        draw_case(bench);
+    }
+    return lite_offscreen_checksum();
+}
+
+
+static double pixels_per_second(const BenchCase* bench, double seconds)
+{
+    uint64_t frequency = lite_cpu_frequency();
+    uint64_t budget    = (uint64_t)(seconds * (double)frequency);
+    uint64_t start     = lite_cpu_ticks();
+    uint64_t elapsed   = 0;
+    lite_renderer_take_stats();
+    while (elapsed < budget)
+    {
+        for (int32_t i = 0; i < 16; i++)
+        {
+            draw_case(bench);
+        }
+        elapsed = lite_cpu_ticks() - start;
+    }
+
+    /* counted by the rasterizer, so glyph pixels are the clipped quads */
+    double pixels = (double)lite_renderer_take_stats().pixels;
+    return pixels * (double)frequency / (double)elapsed;
+}
+
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+    if (seconds <= 0.0)
+    {
+        seconds = 0.5;
+    }
+
+    lite_offscreen_resize(SURFACE_WIDTH, SURFACE_HEIGHT);
+    lite_renderer_init();
+    lite_set_glyph_async(false);
+    lite_renderer_set_clip_rect((LiteRect){ 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT });
+
+    if (argc > 2)
+    {
+        g_font = lite_load_font(lite_string_view(argv[2], strlen(argv[2])), 14.0f);
+        if (g_font == nullptr)
+        {
+            fprintf(stderr, "%s: cannot load font\n", argv[2]);
+        }
+    }
+
+    LitePixelKernels best = lite_renderer_get_pixel_kernels();
+    printf("%-12s", "case");
+    for (int32_t k = 0; k < LitePixelKernels_COUNT; k++)
+    {
+        if (lite_renderer_set_pixel_kernels((LitePixelKernels)k))
+        {
+            printf("  %10s Mpx/s", g_kernel_names[k]);
+        }
+    }
+    printf("\n");
+
+    bool ok = true;
+    for (size_t c = 0; c < __count_of(g_cases); c++)
+    {
+        const BenchCase* bench = &g_cases[c];
+        if (bench->text && g_font == nullptr)
+        {
+            continue;
+        }
+
+        printf("%-12s", bench->name);
+
+        lite_renderer_set_pixel_kernels(LitePixelKernels_Scalar);
+        uint32_t expected = checksum_case(bench);
+        for (int32_t k = 0; k < LitePixelKernels_COUNT; k++)
+        {
+            if (!lite_renderer_set_pixel_kernels((LitePixelKernels)k))
+            {
+                continue;
+            }
+
+            bool same = checksum_case(bench) == expected;
+            ok       &= same;
+            printf("  %16.1f%s", pixels_per_second(bench, seconds) / 1e6, same ? "" : "!");
+        }
+        printf("\n");
+    }
+
+    printf("selected at init: %s, output %s\n", g_kernel_names[best],
+           ok ? "matches scalar" : "DIFFERS from scalar (marked !)");
+
+    if (g_font)
+    {
+        lite_free_font(g_font);
+    }
+    lite_renderer_deinit();
+    lite_offscreen_free();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//! EOF
@@ -0,0 +1,192 @@
+// -----------------------------------------------------------------
+// Draw submission benchmark
+//
+// Runs the renderer Lua module in LuaJIT on an offscreen surface and
+// submits the same rects every frame twice over: through the classic
+// renderer.draw_rect calls, then written into the ffi batch of
+// lite_rencache_ffi.h. Prints the time spent submitting and in
+// end_frame per frame for both, and whether their output matches.
+//
+// Usage: lite_bench_submit [frames, default 200] [rects per frame, default 10000]
+//
+// Build on posix (no window system needed):
+//     cc -O2 -std=c11 -fno-strict-aliasing -Isrc -Isrc/api -Ilibs/luajit_2.1.0-beta3/include -DNDEBUG
+//        src/tools/lite_bench_submit.c src/api/lite_renderer.c src/api/lite_renderer_font.c
+//        src/tools/lite_offscreen.c src/lite_rencache.c src/lite_renderer.c src/lite_memory.c
+//        src/lite_string.c src/lite_thread.c src/lib/stb/*.c -lluajit-5.1 -lm -lpthread -ldl
+// -----------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lite_api.h"
+#include "lite_rencache.h"
+#include "lite_renderer.h"
+#include "lite_window.h"
+#include "tools/lite_offscreen.h"
+
+
+#define SURFACE_WIDTH  1920
+#define SURFACE_HEIGHT 1080
+
+
+int luaopen_renderer(lua_State* L);
+
+
+static const char g_script[] =
+    "local frames, count = ...\n"
+    "local ffi = require('ffi')\n"
+    "local width, height = renderer.get_size()\n"
+    "\n"
+    "local colors, packed = {}, {}\n"
+    "for i = 1, 4 do\n"
+    "  local r, g, b, a = 40 * i, 255 - 50 * i, 60 + 30 * i, i == 4 and 128 or 255\n"
+    "  colors[i] = { r, g, b, a }\n"
+    "  packed[i] = r * 0x1000000 + g * 0x10000 + b * 0x100 + a\n"
+    "end\n"
+    "\n"
+    "local function classic(frame)\n"
+    "  renderer.set_clip_rect(0, 0, width, height)\n"
+    "  for i = 0, count - 1 do\n"
+    "    local x = (i * 37 + frame * 3) % (width - 16)\n"
+    "    local y = (i * 91) % (height - 16)\n"
+    "    renderer.draw_rect(x, y, 12, 12, colors[i % 4 + 1])\n"
+    "  end\n"
+    "end\n"
+    "\n"
+    "ffi.cdef(renderer.ffi_cdef)\n"
+    "local rc = ffi.cast('LiteRencacheFfi*', renderer.get_ffi())\n"
+    "local commands, capacity = rc.commands, rc.capacity\n"
+    "\n"
+    "local function batched(frame)\n"
+    "  local c = commands[rc.count]\n"
+    "  c.type, c.x, c.y, c.width, c.height = ffi.C.LITE_RENCACHE_FFI_SET_CLIP, 0, 0, width, height\n"
+    "  rc.count = rc.count + 1\n"
+    "  for i = 0, count - 1 do\n"
+    "    local n = rc.count\n"
+    "    if n == capacity then\n"
+    "      rc.flush()\n"
+    "      n = 0\n"
+    "    end\n"
+    "    c = commands[n]\n"
+    "    c.type   = ffi.C.LITE_RENCACHE_FFI_DRAW_RECT\n"
+    "    c.x      = (i * 37 + frame * 3) % (width - 16)\n"
+    "    c.y      = (i * 91) % (height - 16)\n"
+    "    c.width  = 12\n"
+    "    c.height = 12\n"
+    "    c.color  = packed[i % 4 + 1]\n"
+    "    rc.count = n + 1\n"
+    "  end\n"
+    "end\n"
+    "\n"
+    "local function run(name, submit)\n"
+    "  local submit_time, end_time = 0, 0\n"
+    "  bench.reset()\n"
+    "  for frame = 1, frames do\n"
+    "    local t0 = bench.seconds()\n"
+    "    renderer.begin_frame()\n"
+    "    submit(frame)\n"
+    "    local t1 = bench.seconds()\n"
+    "    renderer.end_frame()\n"
+    "    local t2 = bench.seconds()\n"
+    "    submit_time, end_time = submit_time + t1 - t0, end_time + t2 - t1\n"
+    "  end\n"
+    "  print(string.format('%-8s %10.3f %10.3f %10.1f %10s', name, submit_time * 1e3 / frames,\n"
+    "                      end_time * 1e3 / frames, count * frames / submit_time / 1e6,\n"
+    "                      string.format('%08x', bench.checksum())))\n"
+    "  return bench.checksum()\n"
+    "end\n"
+    "\n"
+    "print(string.format('%-8s %10s %10s %10s %10s', 'path', 'submit ms', 'end ms', 'Mrect/s', 'checksum'))\n"
+    "local a = run('classic', classic)\n"
+    "local b = run('ffi', batched)\n"
+    "return a == b\n";
+
+
+static int f_seconds(lua_State* L)
+{
+    lua_pushnumber(L, (double)lite_cpu_ticks() / (double)lite_cpu_frequency());
+    return 1;
+}
+
+
+/* both paths start from a blank surface, rects leave trails behind */
+static int f_reset(lua_State* L)
+{
+    (void)L;
+
+    int32_t    width, height;
+    LiteColor* pixels = (LiteColor*)lite_window_surface(&width, &height);
+    memset(pixels, 0, (size_t)width * height * sizeof(LiteColor));
+    lite_rencache_invalidate();
+    return 0;
+}
+
+
+static int f_checksum(lua_State* L)
+{
+    lua_pushnumber(L, lite_offscreen_checksum());
+    return 1;
+}
+
+
+static const luaL_Reg g_bench[] = {
+    { "seconds",  f_seconds  },
+    { "reset",    f_reset    },
+    { "checksum", f_checksum },
+    { nullptr,    nullptr    },
+};
+
+
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 200;
+    int count  = argc > 2 ? atoi(argv[2]) : 10000;
+    if (frames <= 0 || count <= 0)
+    {
+        fprintf(stderr, "usage: %s [frames] [rects per frame]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    lite_offscreen_resize(SURFACE_WIDTH, SURFACE_HEIGHT);
+    lite_renderer_init();
+    lite_rencache_init();
+
+    lua_State* L = luaL_newstate();
+    luaL_openlibs(L);
+    luaopen_renderer(L);
+    lua_setglobal(L, "renderer");
+    luaL_register(L, "bench", g_bench);
+    lua_pop(L, 1);
+
+    bool ok = luaL_loadbuffer(L, g_script, sizeof(g_script) - 1, "=bench") == 0;
+    if (ok)
+    {
+        lua_pushinteger(L, frames);
+        lua_pushinteger(L, count);
+        ok = lua_pcall(L, 2, 1, 0) == 0;
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "%s\n", lua_tostring(L, -1));
+    }
+    else if (!lua_toboolean(L, -1))
+    {
+        printf("output DIFFERS between the paths\n");
+        ok = false;
+    }
+    else
+    {
+        printf("output matches\n");
+    }
+
+    lua_close(L);
+    lite_rencache_deinit();
+    lite_renderer_deinit();
+    lite_offscreen_free();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//! EOF
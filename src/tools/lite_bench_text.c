@@ -0,0 +1,223 @@
+// -----------------------------------------------------------------
+// Text measuring benchmark
+//
+// Splits a source file into the tokens the editor measures when it
+// draws a document (words, symbols and whitespace runs) and times
+// lite_get_font_width over all of them and over the whole lines,
+// printing nanoseconds per call and a sum of the widths to compare
+// builds with. Fails when the caret position past the end of a line
+// is not the width of the line.
+//
+// Usage: lite_bench_text <font.ttf> <source file> [seconds per case, default 0.5] [size, default 14]
+//
+// Build on posix (no window system needed):
+//     cc -O2 -std=c11 -fno-strict-aliasing -Isrc -DNDEBUG src/tools/lite_bench_text.c
+//        src/tools/lite_offscreen.c src/lite_renderer.c src/lite_memory.c
+//        src/lite_string.c src/lite_thread.c src/lib/stb/*.c -lm -lpthread
+// -----------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lite_renderer.h"
+#include "lite_window.h"
+
+
+typedef struct BenchText
+{
+    LiteStringView* items;
+    int32_t         count, capacity;
+} BenchText;
+
+
+static void push_text(BenchText* text, const char* buffer, size_t length)
+{
+    if (text->count == text->capacity)
+    {
+        text->capacity = text->capacity ? text->capacity * 2 : 1024;
+        text->items    = (LiteStringView*)realloc(text->items, text->capacity * sizeof(*text->items));
+        if (text->items == nullptr)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    text->items[text->count++] = lite_string_view(buffer, length);
+}
+
+
+static int32_t char_class(uint8_t c)
+{
+    /* utf-8 bytes stay with the word they are in */
+    if (c == '_' || c >= 0x80 || (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z'))
+    {
+        return 0;
+    }
+    return c == ' ' || c == '\t' ? 1 : 2;
+}
+
+
+static void split_line(BenchText* tokens, const char* line, size_t length)
+{
+    size_t start = 0;
+    while (start < length)
+    {
+        int32_t kind = char_class((uint8_t)line[start]);
+        size_t  end  = start + 1;
+        while (kind != 2 && end < length && char_class((uint8_t)line[end]) == kind)
+        {
+            end++;
+        }
+
+        push_text(tokens, line + start, end - start);
+        start = end;
+    }
+}
+
+
+static char* read_file(const char* path, size_t* size)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr)
+    {
+        return nullptr;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char* data = length > 0 ? (char*)malloc((size_t)length) : nullptr;
+    if (data && fread(data, 1, (size_t)length, fp) != (size_t)length)
+    {
+        free(data);
+        data = nullptr;
+    }
+    fclose(fp);
+
+    *size = (size_t)length;
+    return data;
+}
+
+
+static double nanoseconds_per_item(LiteFont* font, const BenchText* text, double seconds, int64_t* width)
+{
+    uint64_t frequency = lite_cpu_frequency();
+    uint64_t budget    = (uint64_t)(seconds * (double)frequency);
+    uint64_t start     = lite_cpu_ticks();
+    uint64_t elapsed   = 0;
+    int64_t  calls     = 0;
+    int64_t  sum       = 0;
+    while (elapsed < budget)
+    {
+        sum = 0;
+        for (int32_t i = 0; i < text->count; i++)
+        {
+            sum += lite_get_font_width(font, text->items[i]);
+        }
+        calls  += text->count;
+        elapsed = lite_cpu_ticks() - start;
+    }
+
+    *width = sum;
+    return (double)elapsed * 1e9 / (double)frequency / (double)calls;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <font.ttf> <source file> [seconds] [size]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double seconds = argc > 3 ? atof(argv[3]) : 0.5;
+    float  size    = argc > 4 ? (float)atof(argv[4]) : 14.0f;
+    if (seconds <= 0.0)
+    {
+        seconds = 0.5;
+    }
+
+    size_t length = 0;
+    char*  source = read_file(argv[2], &length);
+    if (source == nullptr)
+    {
+        fprintf(stderr, "%s: cannot read file\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    BenchText lines  = {0};
+    BenchText tokens = {0};
+    for (size_t start = 0; start < length;)
+    {
+        const char* newline = (const char*)memchr(source + start, '\n', length - start);
+        size_t      end     = newline ? (size_t)(newline - source) : length;
+        push_text(&lines, source + start, end - start);
+        split_line(&tokens, source + start, end - start);
+        start = end + 1;
+    }
+
+    if (lines.count == 0)
+    {
+        fprintf(stderr, "%s: empty file\n", argv[2]);
+        free(source);
+        return EXIT_FAILURE;
+    }
+
+    lite_renderer_init();
+    lite_set_glyph_async(false);
+
+    LiteFont* font = lite_load_font(lite_string_view(argv[1], strlen(argv[1])), size);
+    if (font == nullptr)
+    {
+        fprintf(stderr, "%s: cannot load font\n", argv[1]);
+        lite_renderer_deinit();
+        return EXIT_FAILURE;
+    }
+
+    /* glyphs outside ascii are cached by a first pass, like in the editor */
+    for (int32_t i = 0; i < lines.count; i++)
+    {
+        lite_get_font_width(font, lines.items[i]);
+    }
+
+    printf("font %s, %s\n", argv[1], lite_is_font_fixed_pitch(font) ? "fixed pitch" : "proportional");
+    printf("%-8s %8s %10s %14s\n", "case", "count", "ns/call", "width sum");
+
+    int64_t width;
+    double  token_ns = nanoseconds_per_item(font, &tokens, seconds, &width);
+    printf("%-8s %8d %10.1f %14lld\n", "tokens", tokens.count, token_ns, (long long)width);
+
+    double  line_ns  = nanoseconds_per_item(font, &lines, seconds, &width);
+    printf("%-8s %8d %10.1f %14lld\n", "lines", lines.count, line_ns, (long long)width);
+
+    /* a caret past the last character sits at the width of the whole line,
+    ** the lines are views into the file and are not nul-terminated */
+    int32_t mismatches = 0;
+    for (int32_t i = 0; i < lines.count; i++)
+    {
+        LiteStringView line = lines.items[i];
+        int32_t        full = lite_get_font_width(font, line);
+        if (lite_get_font_x_at(font, line, line.length) != full
+            || lite_get_font_x_at(font, line, line.length + 1) != full)
+        {
+            mismatches++;
+        }
+    }
+    if (mismatches > 0)
+    {
+        fprintf(stderr, "x at end of line differs from line width on %d lines\n", mismatches);
+    }
+
+    lite_free_font(font);
+    lite_renderer_deinit();
+    free(tokens.items);
+    free(lines.items);
+    free(source);
+    return mismatches > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//! EOF
@@ -0,0 +1,135 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "lite_renderer.h"
+#include "lite_window.h"
+#include "tools/lite_offscreen.h"
+
+
+static LiteColor* g_pixels;
+static int32_t    g_width;
+static int32_t    g_height;
+static int64_t    g_presented;
+
+
+void lite_offscreen_resize(int32_t width, int32_t height)
+{
+    /* like the window, a frame may be drawn on the render thread */
+    lite_renderer_lock_surface();
+    free(g_pixels);
+    g_pixels = (LiteColor*)calloc((size_t)width * height + 1, sizeof(LiteColor));
+    g_width  = width;
+    g_height = height;
+    lite_renderer_unlock_surface();
+
+    if (g_pixels == nullptr)
+    {
+        fprintf(stderr, "Fatal error: memory allocation failed\n");
+        exit(-1);
+    }
+}
+
+
+void lite_offscreen_free(void)
+{
+    free(g_pixels);
+    g_pixels = nullptr;
+    g_width  = 0;
+    g_height = 0;
+}
+
+
+void* lite_window_surface(int32_t* width, int32_t* height)
+{
+    if (width)
+    {
+        *width = g_width;
+    }
+
+    if (height)
+    {
+        *height = g_height;
+    }
+
+    return g_pixels;
+}
+
+
+int64_t lite_offscreen_take_presented(void)
+{
+    int64_t presented = g_presented;
+    g_presented       = 0;
+    return presented;
+}
+
+
+void lite_window_update_rects(struct LiteRect* rects, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        g_presented += (int64_t)rects[i].width * rects[i].height;
+    }
+}
+
+
+void lite_window_show(void)
+{
+}
+
+
+float lite_window_dpi(void)
+{
+    return 96.0f;
+}
+
+
+uint64_t lite_cpu_ticks(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)counter.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+uint64_t lite_cpu_frequency(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)frequency.QuadPart;
+#else
+    return 1000000000ull;
+#endif
+}
+
+
+uint32_t lite_offscreen_checksum(void)
+{
+    uint32_t       hash  = 2166136261u;
+    const uint8_t* bytes = (const uint8_t*)g_pixels;
+    size_t         size  = (size_t)g_width * g_height * sizeof(LiteColor);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+//! EOF
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "lite_meta.h"
+
+// -----------------------------------------------------------------
+// Offscreen window for the headless tools, implements the part of
+// lite_window.h the renderer and the render cache use
+// -----------------------------------------------------------------
+
+/// Reallocate the surface returned by lite_window_surface, cleared to zero
+void        lite_offscreen_resize(int32_t width, int32_t height);
+void        lite_offscreen_free(void);
+
+/// FNV-1a hash of the surface pixels
+uint32_t    lite_offscreen_checksum(void);
+
+/// Area of the rects passed to lite_window_update_rects since the last call
+int64_t     lite_offscreen_take_presented(void);
+
+//! EOF
@@ -0,0 +1,510 @@
+// -----------------------------------------------------------------
+// Headless render trace replay
+//
+// Replays a trace recorded with renderer.start_trace() through the
+// render cache and the software rasterizer into an offscreen surface,
+// printing per-frame timings and a checksum of the output pixels.
+//
+// Usage: lite_replay <trace> [-q] [-a] [-p] [-v] [-c <pixels>] [-m <cells>]
+//     -q  only print the summary
+//     -a  rasterize glyphs in the background like the editor does, the
+//         checksums then depend on timing
+//     -p  draw frames on the render thread like the editor does, timing
+//         only the part of end_frame the editor waits for; the output is
+//         waited for before it is checksummed
+//     -c, --cell-size <pixels>
+//         size of the dirty cells instead of the default for 96 dpi
+//     -m, --merge-threshold <cells>
+//         clean cells a merge of dirty cells may redraw, the pixels
+//         printed per frame compare thresholds on the same trace
+//     -v  after each frame, draw it again until its glyphs are installed
+//         and check that the cached output matches drawing it whole;
+//         fails on the first frame that differs
+//
+// Build on posix (no window system needed):
+//     cc -O2 -std=c11 -fno-strict-aliasing -Isrc -DNDEBUG src/tools/lite_replay.c
+//        src/tools/lite_offscreen.c src/lite_rencache.c src/lite_renderer.c src/lite_memory.c
+//        src/lite_string.c src/lite_thread.c src/lib/stb/*.c -lm -lpthread
+// -----------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lite_rencache.h"
+#include "lite_rencache_trace.h"
+#include "lite_renderer.h"
+#include "lite_window.h"
+#include "tools/lite_offscreen.h"
+
+
+#define MAX_TRACE_FONTS 256
+
+
+/* tokens of the draw tokens command being replayed */
+static LiteTextToken*   g_tokens;
+static uint32_t         g_token_capacity;
+
+
+// -----------------------------------------------------------------
+// Trace reading
+// -----------------------------------------------------------------
+
+typedef struct TraceReader
+{
+    const uint8_t*  data;
+    size_t          size;
+    size_t          position;
+    bool            failed;
+} TraceReader;
+
+
+static bool trace_readable(TraceReader* reader, size_t size)
+{
+    if (reader->failed || reader->size - reader->position < size)
+    {
+        reader->failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+
+static uint32_t trace_read_u32(TraceReader* reader)
+{
+    uint32_t value = 0;
+    if (trace_readable(reader, sizeof(value)))
+    {
+        memcpy(&value, reader->data + reader->position, sizeof(value));
+        reader->position += sizeof(value);
+    }
+    return value;
+}
+
+
+static LiteStringView trace_read_bytes(TraceReader* reader, uint32_t length)
+{
+    LiteStringView view = lite_string_view("", 0);
+    if (trace_readable(reader, length))
+    {
+        view              = lite_string_view((const char*)reader->data + reader->position, length);
+        reader->position += length;
+    }
+    return view;
+}
+
+
+static LiteRect trace_read_rect(TraceReader* reader)
+{
+    LiteRect rect;
+    rect.x      = (int32_t)trace_read_u32(reader);
+    rect.y      = (int32_t)trace_read_u32(reader);
+    rect.width  = (int32_t)trace_read_u32(reader);
+    rect.height = (int32_t)trace_read_u32(reader);
+    return rect;
+}
+
+
+static LiteColor trace_read_color(TraceReader* reader)
+{
+    uint32_t  value = trace_read_u32(reader);
+    LiteColor color;
+    memcpy(&color, &value, sizeof(color));
+    return color;
+}
+
+
+static uint8_t* read_file(const char* path, size_t* size)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr)
+    {
+        return nullptr;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    uint8_t* data = length > 0 ? (uint8_t*)malloc((size_t)length) : nullptr;
+    if (data && fread(data, 1, (size_t)length, fp) != (size_t)length)
+    {
+        free(data);
+        data = nullptr;
+    }
+    fclose(fp);
+
+    *size = (size_t)length;
+    return data;
+}
+
+
+// -----------------------------------------------------------------
+// Replay
+// -----------------------------------------------------------------
+
+static bool replay_frame(TraceReader* reader, LiteFont** fonts)
+{
+    int32_t  width  = (int32_t)trace_read_u32(reader);
+    int32_t  height = (int32_t)trace_read_u32(reader);
+    uint32_t count  = trace_read_u32(reader);
+    if (reader->failed || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    int32_t surface_width, surface_height;
+    lite_window_surface(&surface_width, &surface_height);
+    if (width != surface_width || height != surface_height)
+    {
+        lite_offscreen_resize(width, height);
+    }
+
+    lite_rencache_begin_frame();
+    for (uint32_t i = 0; i < count && !reader->failed; i++)
+    {
+        switch (trace_read_u32(reader))
+        {
+        case LiteTraceCommand_SetClip:
+            lite_rencache_set_clip_rect(trace_read_rect(reader));
+            break;
+
+        case LiteTraceCommand_DrawRect:
+        {
+            LiteRect  rect  = trace_read_rect(reader);
+            LiteColor color = trace_read_color(reader);
+            lite_rencache_draw_rect(rect, color);
+            break;
+        }
+
+        case LiteTraceCommand_DrawText:
+        {
+            uint32_t       id        = trace_read_u32(reader);
+            int32_t        x         = (int32_t)trace_read_u32(reader);
+            int32_t        y         = (int32_t)trace_read_u32(reader);
+            LiteColor      color     = trace_read_color(reader);
+            int32_t        tab_width = (int32_t)trace_read_u32(reader);
+            LiteStringView text      = trace_read_bytes(reader, trace_read_u32(reader));
+            if (id >= MAX_TRACE_FONTS || fonts[id] == nullptr)
+            {
+                return false;
+            }
+
+            if (lite_get_font_tab_width(fonts[id]) != tab_width)
+            {
+                lite_set_font_tab_width(fonts[id], tab_width);
+            }
+            lite_rencache_draw_text(fonts[id], text, x, y, color);
+            break;
+        }
+
+        case LiteTraceCommand_DrawTokens:
+        {
+            uint32_t id        = trace_read_u32(reader);
+            int32_t  x         = (int32_t)trace_read_u32(reader);
+            int32_t  y         = (int32_t)trace_read_u32(reader);
+            int32_t  tab_width = (int32_t)trace_read_u32(reader);
+            uint32_t count     = trace_read_u32(reader);
+            if (id >= MAX_TRACE_FONTS || fonts[id] == nullptr || !trace_readable(reader, (size_t)count * 8))
+            {
+                return false;
+            }
+
+            if (count > g_token_capacity)
+            {
+                g_token_capacity = count;
+                g_tokens         = (LiteTextToken*)realloc(g_tokens, count * sizeof(LiteTextToken));
+                if (g_tokens == nullptr)
+                {
+                    return false;
+                }
+            }
+
+            /* lengths and colors come first, the texts are read after them */
+            for (uint32_t t = 0; t < count; t++)
+            {
+                g_tokens[t].text.length = trace_read_u32(reader);
+                g_tokens[t].color       = trace_read_color(reader);
+            }
+            for (uint32_t t = 0; t < count; t++)
+            {
+                g_tokens[t].text = trace_read_bytes(reader, (uint32_t)g_tokens[t].text.length);
+            }
+            if (reader->failed)
+            {
+                return false;
+            }
+
+            if (lite_get_font_tab_width(fonts[id]) != tab_width)
+            {
+                lite_set_font_tab_width(fonts[id], tab_width);
+            }
+            lite_rencache_draw_tokens(fonts[id], g_tokens, (int32_t)count, x, y);
+            break;
+        }
+
+        case LiteTraceCommand_FreeFont:
+        {
+            uint32_t id = trace_read_u32(reader);
+            if (id < MAX_TRACE_FONTS && fonts[id] != nullptr)
+            {
+                lite_rencache_free_font(fonts[id]);
+                fonts[id] = nullptr;
+            }
+            break;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    return !reader->failed;
+}
+
+
+/* draws a frame again until no text of it waits on glyphs, so the cells of
+** that text are redrawn once the glyphs are installed, then compares the
+** output with a full redraw; false when the frame can't be drawn twice,
+** like one drawing with a font it frees */
+static bool verify_frame(const TraceReader* start, LiteFont** fonts, bool* matches)
+{
+    bool replayed;
+    do
+    {
+        TraceReader reader = *start;
+        replayed           = replay_frame(&reader, fonts);
+        lite_rencache_end_frame();
+        lite_rencache_wait();
+    } while (replayed && lite_rencache_has_pending_glyphs());
+
+    if (!replayed)
+    {
+        return false;
+    }
+    uint32_t cached = lite_offscreen_checksum();
+
+    TraceReader reader = *start;
+    lite_rencache_invalidate();
+    replayed = replay_frame(&reader, fonts);
+    lite_rencache_end_frame();
+    lite_rencache_wait();
+
+    *matches = lite_offscreen_checksum() == cached;
+    return replayed;
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* path  = nullptr;
+    bool        quiet = false;
+    bool        async = false;
+    bool        pipe  = false;
+    bool        check = false;
+    int32_t     cells = 0;
+    int32_t     merge = -1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-q") == 0)
+        {
+            quiet = true;
+        }
+        else if (strcmp(argv[i], "-a") == 0)
+        {
+            async = true;
+        }
+        else if (strcmp(argv[i], "-p") == 0)
+        {
+            pipe = true;
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            check = true;
+        }
+        else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--cell-size") == 0) && i + 1 < argc)
+        {
+            cells = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--merge-threshold") == 0) && i + 1 < argc)
+        {
+            merge = atoi(argv[++i]);
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    if (path == nullptr)
+    {
+        fprintf(stderr, "usage: %s <trace> [-q] [-a] [-p] [-v] [-c <pixels>] [-m <cells>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t   size = 0;
+    uint8_t* data = read_file(path, &size);
+    if (data == nullptr)
+    {
+        fprintf(stderr, "%s: cannot read trace\n", path);
+        return EXIT_FAILURE;
+    }
+
+    /* later versions only add commands, older traces replay as they are */
+    TraceReader reader  = { .data = data, .size = size };
+    uint32_t    magic   = trace_read_u32(&reader);
+    uint32_t    version = trace_read_u32(&reader);
+    if (magic != LITE_TRACE_MAGIC || version < 1 || version > LITE_TRACE_VERSION)
+    {
+        fprintf(stderr, "%s: not a render trace of version 1 to %d\n", path, LITE_TRACE_VERSION);
+        free(data);
+        return EXIT_FAILURE;
+    }
+
+    lite_renderer_init();
+    lite_rencache_init();
+    lite_set_glyph_async(async);
+    lite_rencache_set_async(pipe);
+    if (cells > 0)
+    {
+        lite_rencache_set_cell_size(cells);
+    }
+    if (merge >= 0)
+    {
+        lite_rencache_set_merge_threshold(merge);
+    }
+
+    LiteFont* fonts[MAX_TRACE_FONTS] = {0};
+    int32_t   frames                 = 0;
+    double    total_ms               = 0.0;
+    double    min_ms                 = 0.0;
+    double    max_ms                 = 0.0;
+    uint32_t  checksum               = 2166136261u;
+    int64_t   pixels                 = 0;
+    int64_t   rects                  = 0;
+    int64_t   presented              = 0;
+    int32_t   verified               = 0;
+    bool      differs                = false;
+    bool      ok                     = true;
+    while (ok && !differs && reader.position < reader.size)
+    {
+        switch (trace_read_u32(&reader))
+        {
+        case LiteTraceRecord_Font:
+        {
+            uint32_t       id        = trace_read_u32(&reader);
+            uint32_t       size_bits = trace_read_u32(&reader);
+            LiteStringView filename  = trace_read_bytes(&reader, trace_read_u32(&reader));
+
+            float font_size;
+            memcpy(&font_size, &size_bits, sizeof(font_size));
+
+            /* lite_load_font wants a nul-terminated path */
+            char font_path[1024];
+            if (reader.failed || id >= MAX_TRACE_FONTS || filename.length >= sizeof(font_path))
+            {
+                ok = false;
+                break;
+            }
+            memcpy(font_path, filename.buffer, filename.length);
+            font_path[filename.length] = '\0';
+
+            fonts[id] = lite_load_font(lite_string_view(font_path, filename.length), font_size);
+            if (fonts[id] == nullptr)
+            {
+                fprintf(stderr, "%s: cannot load font %s\n", path, font_path);
+                ok = false;
+            }
+            break;
+        }
+
+        case LiteTraceRecord_Invalidate:
+            lite_rencache_invalidate();
+            break;
+
+        case LiteTraceRecord_Frame:
+        {
+            TraceReader frame_start = reader;
+            if (!replay_frame(&reader, fonts))
+            {
+                ok = false;
+                break;
+            }
+
+            uint64_t start = lite_cpu_ticks();
+            lite_rencache_end_frame();
+            double   ms    = (double)(lite_cpu_ticks() - start) * 1000.0 / (double)lite_cpu_frequency();
+
+            lite_rencache_wait();
+            uint32_t frame_checksum = lite_offscreen_checksum();
+            checksum                = (checksum ^ frame_checksum) * 16777619u;
+            min_ms                  = frames == 0 || ms < min_ms ? ms : min_ms;
+            max_ms                  = ms > max_ms ? ms : max_ms;
+            total_ms               += ms;
+
+            LiteRencacheStats stats;
+            lite_rencache_get_stats(&stats);
+            pixels    += stats.pixels;
+            rects     += stats.dirty_rects;
+            presented += lite_offscreen_take_presented();
+            if (!quiet)
+            {
+                printf("frame %6d %8.3f ms  commands %5d  rects %4d  pixels %9lld  glyphs %6lld  checksum %08x\n",
+                       frames, ms, stats.command_count, stats.dirty_rects,
+                       (long long)stats.pixels, (long long)stats.glyphs, frame_checksum);
+            }
+
+            bool matches = true;
+            if (check && verify_frame(&frame_start, fonts, &matches))
+            {
+                verified++;
+                if (!matches)
+                {
+                    fprintf(stderr, "%s: frame %d drawn from the cache differs from a full redraw\n", path, frames);
+                    differs = true;
+                }
+            }
+            frames++;
+            break;
+        }
+
+        default:
+            ok = false;
+            break;
+        }
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "%s: malformed trace at offset %zu\n", path, reader.position);
+    }
+
+    printf("frames %d  total %.3f ms  avg %.3f ms  min %.3f ms  max %.3f ms  checksum %08x\n",
+           frames, total_ms, frames ? total_ms / frames : 0.0, min_ms, max_ms, checksum);
+    printf("cell size %d  merge threshold %d  rects %lld  pixels rasterized %lld  presented %lld\n",
+           lite_rencache_get_cell_size(), lite_rencache_get_merge_threshold(),
+           (long long)rects, (long long)pixels, (long long)presented);
+    if (check)
+    {
+        printf("verified %d frames against full redraws%s\n", verified, differs ? ", one differs" : "");
+    }
+
+    /* traces stopped before the editor quit leave their fonts loaded */
+    for (int32_t i = 0; i < MAX_TRACE_FONTS; i++)
+    {
+        if (fonts[i])
+        {
+            lite_free_font(fonts[i]);
+        }
+    }
+
+    lite_rencache_deinit();
+    lite_renderer_deinit();
+    lite_offscreen_free();
+    free(g_tokens);
+    free(data);
+    return ok && !differs ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//! EOF